@@ -49,6 +49,23 @@
 #define CMD_IDENTIFY_DEVICE 0xec        /* IDENTIFY DEVICE. */
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
+#define CMD_READ_SECTOR_EXT 0x24        /* READ SECTOR(S) EXT. */
+#define CMD_WRITE_SECTOR_EXT 0x34       /* WRITE SECTOR(S) EXT. */
+
+/* IDENTIFY DEVICE words that we consult. */
+#define ID_LBA28_SECTORS 60     /* Words 60-61: LBA28 capacity. */
+#define ID_COMMAND_SETS 83      /* Word 83: command sets supported. */
+#define ID_LBA48_SECTORS 100    /* Words 100-103: LBA48 capacity. */
+
+/* Word 83 bits. */
+#define ID_CS_LBA48 0x0400      /* 48-bit Address feature set. */
+
+/* Highest sector number plus one addressable with 28-bit LBA. */
+#define LBA28_LIMIT (1UL << 28)
+
+/* Most sectors moved by one READ or WRITE SECTOR(S) command.  A
+   28-bit command's sector count register holds 256 as 0. */
+#define MAX_XFER_SECTORS 256
 
 /* An ATA device. */
 struct ata_disk
@@ -57,6 +74,7 @@ struct ata_disk
     struct channel *channel;    /* Channel that disk is attached to. */
     int dev_no;                 /* Device 0 or 1 for master or slave. */
     bool is_ata;                /* Is device an ATA disk? */
+    bool lba48;                 /* Supports 48-bit LBA? */
   };
 
 /* An ATA channel (aka controller).
@@ -81,11 +99,16 @@ static struct channel channels[CHANNEL_CNT];
 
 static struct block_operations ide_operations;
 
+/* If false (default), ignore disks of 1 GB or more.
+   If true, register disks of any size.
+   Controlled by kernel command-line option "-ide-large". */
+bool ide_large_disks;
+
 static void reset_channel (struct channel *);
 static bool check_device_type (struct ata_disk *);
 static void identify_ata_device (struct ata_disk *);
 
-static void select_sector (struct ata_disk *, block_sector_t);
+static bool select_sector (struct ata_disk *, block_sector_t, size_t cnt);
 static void issue_pio_command (struct channel *, uint8_t command);
 static void input_sector (struct channel *, void *);
 static void output_sector (struct channel *, const void *);
@@ -136,6 +159,7 @@ ide_init (void)
           d->channel = c;
           d->dev_no = dev_no;
           d->is_ata = false;
+          d->lba48 = false;
         }
 
       /* Register interrupt handler. */
@@ -260,7 +284,8 @@ static void
 identify_ata_device (struct ata_disk *d) 
 {
   struct channel *c = d->channel;
-  char id[BLOCK_SECTOR_SIZE];
+  uint16_t id[BLOCK_SECTOR_SIZE / 2];
+  uint64_t sectors;
   block_sector_t capacity;
   char *model, *serial;
   char extra_info[128];
@@ -281,23 +306,36 @@ identify_ata_device (struct ata_disk *d)
     }
   input_sector (c, id);
 
-  /* Calculate capacity.
+  /* Calculate capacity.  Disks that support the 48-bit Address
+     feature set report their full size in words 100-103; the
+     28-bit count in words 60-61 saturates at 128 GB.  Sector
+     numbers beyond what block_sector_t can hold are unusable.
      Read model name and serial number. */
-  capacity = *(uint32_t *) &id[60 * 2];
-  model = descramble_ata_string (&id[10 * 2], 20);
-  serial = descramble_ata_string (&id[27 * 2], 40);
+  d->lba48 = (id[ID_COMMAND_SETS] & ID_CS_LBA48) != 0;
+  if (d->lba48)
+    sectors = (id[ID_LBA48_SECTORS]
+               | (uint64_t) id[ID_LBA48_SECTORS + 1] << 16
+               | (uint64_t) id[ID_LBA48_SECTORS + 2] << 32
+               | (uint64_t) id[ID_LBA48_SECTORS + 3] << 48);
+  else
+    sectors = id[ID_LBA28_SECTORS] | (uint32_t) id[ID_LBA28_SECTORS + 1] << 16;
+  capacity = sectors > UINT32_MAX ? UINT32_MAX : sectors;
+  model = descramble_ata_string ((char *) &id[10], 20);
+  serial = descramble_ata_string ((char *) &id[27], 40);
   snprintf (extra_info, sizeof extra_info,
-            "model \"%s\", serial \"%s\"", model, serial);
+            "model \"%s\", serial \"%s\"%s", model, serial,
+            d->lba48 ? ", LBA48" : "");
 
   /* Disable access to IDE disks over 1 GB, which are likely
      physical IDE disks rather than virtual ones.  If we don't
      allow access to those, we're less likely to scribble on
      someone's important data.  You can disable this check by
-     hand if you really want to do so. */
-  if (capacity >= 1024 * 1024 * 1024 / BLOCK_SECTOR_SIZE)
+     hand if you really want to do so, or pass "-ide-large" on the
+     kernel command line. */
+  if (!ide_large_disks && capacity >= 1024 * 1024 * 1024 / BLOCK_SECTOR_SIZE)
     {
       printf ("%s: ignoring ", d->name);
-      print_human_readable_size (capacity * 512);
+      print_human_readable_size ((uint64_t) capacity * BLOCK_SECTOR_SIZE);
       printf ("disk for safety\n");
       d->is_ata = false;
       return;
@@ -337,68 +375,154 @@ descramble_ata_string (char *string, int size)
   return string;
 }
 
-/* Reads sector SEC_NO from disk D into BUFFER, which must have
-   room for BLOCK_SECTOR_SIZE bytes.
+/* Reads CNT sectors starting at SEC_NO from disk D into BUFFER,
+   which must have room for CNT * BLOCK_SECTOR_SIZE bytes.  Each
+   command moves up to MAX_XFER_SECTORS sectors; the disk raises
+   an interrupt as each one becomes ready to read.
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
 static void
-ide_read (void *d_, block_sector_t sec_no, void *buffer)
+ide_read_multiple (void *d_, block_sector_t sec_no, size_t cnt,
+                   void *buffer_)
 {
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
+  uint8_t *buffer = buffer_;
+
   lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-  sema_down (&c->completion_wait);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-  input_sector (c, buffer);
+  while (cnt > 0)
+    {
+      size_t n = cnt < MAX_XFER_SECTORS ? cnt : MAX_XFER_SECTORS;
+      bool ext = select_sector (d, sec_no, n);
+      size_t i;
+
+      issue_pio_command (c, ext ? CMD_READ_SECTOR_EXT : CMD_READ_SECTOR_RETRY);
+      for (i = 0; i < n; i++)
+        {
+          sema_down (&c->completion_wait);
+          if (!wait_while_busy (d))
+            PANIC ("%s: disk read failed, sector=%"PRDSNu,
+                   d->name, sec_no + i);
+          input_sector (c, buffer);
+          buffer += BLOCK_SECTOR_SIZE;
+        }
+      sec_no += n;
+      cnt -= n;
+    }
   lock_release (&c->lock);
 }
 
-/* Write sector SEC_NO to disk D from BUFFER, which must contain
-   BLOCK_SECTOR_SIZE bytes.  Returns after the disk has
-   acknowledged receiving the data.
+/* Writes CNT sectors starting at SEC_NO to disk D from BUFFER,
+   which must contain CNT * BLOCK_SECTOR_SIZE bytes.  Returns
+   after the disk has acknowledged receiving all of the data.
+   Each command moves up to MAX_XFER_SECTORS sectors; the disk
+   raises an interrupt as it finishes with each one.
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
 static void
-ide_write (void *d_, block_sector_t sec_no, const void *buffer)
+ide_write_multiple (void *d_, block_sector_t sec_no, size_t cnt,
+                    const void *buffer_)
 {
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
+  const uint8_t *buffer = buffer_;
+
   lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-  output_sector (c, buffer);
-  sema_down (&c->completion_wait);
+  while (cnt > 0)
+    {
+      size_t n = cnt < MAX_XFER_SECTORS ? cnt : MAX_XFER_SECTORS;
+      bool ext = select_sector (d, sec_no, n);
+      size_t i;
+
+      issue_pio_command (c, (ext ? CMD_WRITE_SECTOR_EXT
+                             : CMD_WRITE_SECTOR_RETRY));
+      for (i = 0; i < n; i++)
+        {
+          if (!wait_while_busy (d))
+            PANIC ("%s: disk write failed, sector=%"PRDSNu,
+                   d->name, sec_no + i);
+          output_sector (c, buffer);
+          buffer += BLOCK_SECTOR_SIZE;
+          sema_down (&c->completion_wait);
+        }
+      sec_no += n;
+      cnt -= n;
+    }
   lock_release (&c->lock);
 }
 
+/* Reads sector SEC_NO from disk D into BUFFER, which must have
+   room for BLOCK_SECTOR_SIZE bytes. */
+static void
+ide_read (void *d, block_sector_t sec_no, void *buffer)
+{
+  ide_read_multiple (d, sec_no, 1, buffer);
+}
+
+/* Write sector SEC_NO to disk D from BUFFER, which must contain
+   BLOCK_SECTOR_SIZE bytes.  Returns after the disk has
+   acknowledged receiving the data. */
+static void
+ide_write (void *d, block_sector_t sec_no, const void *buffer)
+{
+  ide_write_multiple (d, sec_no, 1, buffer);
+}
+
 static struct block_operations ide_operations =
   {
     ide_read,
-    ide_write
+    ide_write,
+    ide_read_multiple,
+    ide_write_multiple
   };
-
+
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
-static void
-select_sector (struct ata_disk *d, block_sector_t sec_no)
+   writes SEC_NO and the sector count CNT, 1...MAX_XFER_SECTORS,
+   to the disk's sector selection registers.  (We use LBA mode.)
+
+   Transfers that end below 128 GB are addressed with 28-bit LBA, which every
+   ATA disk supports.  Sectors above that require the 48-bit
+   Address feature set, whose registers are FIFOs two bytes deep:
+   we write the high-order bytes first, then the low-order ones.
+   Returns true if the caller must issue an EXT command, false
+   for a 28-bit command. */
+static bool
+select_sector (struct ata_disk *d, block_sector_t sec_no, size_t cnt)
 {
   struct channel *c = d->channel;
+  uint8_t dev = DEV_MBS | DEV_LBA | (d->dev_no == 1 ? DEV_DEV : 0);
+  uint32_t last = sec_no + (cnt - 1);
 
-  ASSERT (sec_no < (1UL << 28));
+  ASSERT (cnt >= 1 && cnt <= MAX_XFER_SECTORS);
+  ASSERT (last < LBA28_LIMIT || d->lba48);
   
   select_device_wait (d);
-  outb (reg_nsect (c), 1);
-  outb (reg_lbal (c), sec_no);
-  outb (reg_lbam (c), sec_no >> 8);
-  outb (reg_lbah (c), (sec_no >> 16));
-  outb (reg_device (c),
-        DEV_MBS | DEV_LBA | (d->dev_no == 1 ? DEV_DEV : 0) | (sec_no >> 24));
+  if (last < LBA28_LIMIT)
+    {
+      outb (reg_nsect (c), cnt);
+      outb (reg_lbal (c), sec_no);
+      outb (reg_lbam (c), sec_no >> 8);
+      outb (reg_lbah (c), sec_no >> 16);
+      outb (reg_device (c), dev | (sec_no >> 24));
+      return false;
+    }
+  else
+    {
+      /* High-order bytes: sector count 15:8 and LBA 47:24.
+         block_sector_t is 32 bits, so LBA 47:32 is always 0. */
+      outb (reg_nsect (c), cnt >> 8);
+      outb (reg_lbal (c), sec_no >> 24);
+      outb (reg_lbam (c), 0);
+      outb (reg_lbah (c), 0);
+
+      /* Low-order bytes: sector count 7:0 and LBA 23:0. */
+      outb (reg_nsect (c), cnt);
+      outb (reg_lbal (c), sec_no);
+      outb (reg_lbam (c), sec_no >> 8);
+      outb (reg_lbah (c), sec_no >> 16);
+      outb (reg_device (c), dev);
+      return true;
+    }
 }
 
 /* Writes COMMAND to channel C and prepares for receiving a
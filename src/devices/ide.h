@@ -1,6 +1,13 @@
 #ifndef DEVICES_IDE_H
 #define DEVICES_IDE_H
 
+#include <stdbool.h>
+
+/* If false (default), ignore disks of 1 GB or more.
+   If true, register disks of any size.
+   Controlled by kernel command-line option "-ide-large". */
+extern bool ide_large_disks;
+
 void ide_init (void);
 
 #endif /* devices/ide.h */
@@ -41,6 +41,25 @@ input_getc (void)
   return key;
 }
 
+/* Retrieves a key from the input buffer into *KEY, like
+   input_getc(), but gives up if the wait for a key is
+   interrupted by thread_interrupt().
+   Returns true if successful, false if interrupted. */
+bool
+input_getc_interruptible (uint8_t *key)
+{
+  enum intr_level old_level;
+  bool success;
+
+  old_level = intr_disable ();
+  success = intq_getc_interruptible (&buffer, key);
+  if (success)
+    serial_notify ();
+  intr_set_level (old_level);
+
+  return success;
+}
+
 /* Returns true if the input buffer is full,
    false otherwise.
    Interrupts must be off. */
@@ -3,8 +3,10 @@
 #include "threads/thread.h"
 
 static int next (int pos);
-static void wait (struct intq *q, struct thread **waiter);
-static void signal (struct intq *q, struct thread **waiter);
+static bool getc (struct intq *q, uint8_t *byte, bool interruptible);
+static bool wait (struct intq *q, struct semaphore **waiter,
+                  bool interruptible);
+static void signal (struct intq *q, struct semaphore **waiter);
 
 /* Initializes interrupt queue Q. */
 void
@@ -38,20 +40,43 @@ uint8_t
 intq_getc (struct intq *q) 
 {
   uint8_t byte;
-  
+
+  getc (q, &byte, false);
+  return byte;
+}
+
+/* Removes a byte from Q and stores it in *BYTE, like
+   intq_getc(), but gives up if the wait for a byte is
+   interrupted by thread_interrupt().
+   Returns true if successful, false if interrupted. */
+bool
+intq_getc_interruptible (struct intq *q, uint8_t *byte)
+{
+  return getc (q, byte, true);
+}
+
+/* Does the work of intq_getc() and intq_getc_interruptible(). */
+static bool
+getc (struct intq *q, uint8_t *byte, bool interruptible)
+{
   ASSERT (intr_get_level () == INTR_OFF);
   while (intq_empty (q)) 
     {
+      bool success = true;
+
       ASSERT (!intr_context ());
       lock_acquire (&q->lock);
-      wait (q, &q->not_empty);
+      if (intq_empty (q))
+        success = wait (q, &q->not_empty, interruptible);
       lock_release (&q->lock);
+      if (!success)
+        return false;
     }
   
-  byte = q->buf[q->tail];
+  *byte = q->buf[q->tail];
   q->tail = next (q->tail);
   signal (q, &q->not_full);
-  return byte;
+  return true;
 }
 
 /* Adds BYTE to the end of Q.
@@ -65,7 +90,8 @@ intq_putc (struct intq *q, uint8_t byte)
     {
       ASSERT (!intr_context ());
       lock_acquire (&q->lock);
-      wait (q, &q->not_full);
+      if (intq_full (q))
+        wait (q, &q->not_full, false);
       lock_release (&q->lock);
     }
 
@@ -82,17 +108,34 @@ next (int pos)
 }
 
 /* WAITER must be the address of Q's not_empty or not_full
-   member.  Waits until the given condition is true. */
-static void
-wait (struct intq *q UNUSED, struct thread **waiter) 
+   member.  Waits until the given condition is true, or, if
+   INTERRUPTIBLE, until thread_interrupt() is called on the
+   current thread.  Returns false if interrupted, true
+   otherwise. */
+static bool
+wait (struct intq *q UNUSED, struct semaphore **waiter,
+      bool interruptible)
 {
+  struct semaphore sema;
+  bool success = true;
+
   ASSERT (!intr_context ());
   ASSERT (intr_get_level () == INTR_OFF);
   ASSERT ((waiter == &q->not_empty && intq_empty (q))
           || (waiter == &q->not_full && intq_full (q)));
 
-  *waiter = thread_current ();
-  thread_block ();
+  sema_init (&sema, 0);
+  *waiter = &sema;
+  if (interruptible)
+    success = sema_down_interruptible (&sema);
+  else
+    sema_down (&sema);
+
+  /* signal() clears *WAITER before upping SEMA, so only an
+     interrupted wait leaves it set. */
+  if (!success)
+    *waiter = NULL;
+  return success;
 }
 
 /* WAITER must be the address of Q's not_empty or not_full
@@ -100,7 +143,7 @@ wait (struct intq *q UNUSED, struct thread **waiter)
    thread is waiting for the condition, wakes it up and resets
    the waiting thread. */
 static void
-signal (struct intq *q UNUSED, struct thread **waiter) 
+signal (struct intq *q UNUSED, struct semaphore **waiter)
 {
   ASSERT (intr_get_level () == INTR_OFF);
   ASSERT ((waiter == &q->not_empty && !intq_empty (q))
@@ -108,7 +151,8 @@ signal (struct intq *q UNUSED, struct thread **waiter)
 
   if (*waiter != NULL) 
     {
-      thread_unblock (*waiter);
+      struct semaphore *sema = *waiter;
       *waiter = NULL;
+      sema_up (sema);
     }
 }
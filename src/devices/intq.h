@@ -25,8 +25,8 @@ struct intq
   {
     /* Waiting threads. */
     struct lock lock;           /* Only one thread may wait at once. */
-    struct thread *not_full;    /* Thread waiting for not-full condition. */
-    struct thread *not_empty;   /* Thread waiting for not-empty condition. */
+    struct semaphore *not_full; /* Upped for thread waiting for not-full. */
+    struct semaphore *not_empty; /* Upped for thread waiting for not-empty. */
 
     /* Queue. */
     uint8_t buf[INTQ_BUFSIZE];  /* Buffer. */
@@ -38,6 +38,7 @@ void intq_init (struct intq *);
 bool intq_empty (const struct intq *);
 bool intq_full (const struct intq *);
 uint8_t intq_getc (struct intq *);
+bool intq_getc_interruptible (struct intq *, uint8_t *);
 void intq_putc (struct intq *, uint8_t);
 
 #endif /* devices/intq.h */
@@ -37,6 +37,14 @@
 #define IER_RECV 0x01           /* Interrupt when data received. */
 #define IER_XMIT 0x02           /* Interrupt when transmit finishes. */
 
+/* FIFO Control Register bits. */
+#define FCR_ENABLE 0x01         /* Enable receive and transmit FIFOs. */
+#define FCR_CLEAR_RX 0x02       /* Clear receive FIFO. */
+#define FCR_CLEAR_TX 0x04       /* Clear transmit FIFO. */
+
+/* Interrupt Identification Register bits. */
+#define IIR_FIFO 0xc0           /* Both set iff FIFOs are enabled and work. */
+
 /* Line Control Register bits. */
 #define LCR_N81 0x03            /* No parity, 8 data bits, 1 stop bit. */
 #define LCR_DLAB 0x80           /* Divisor Latch Access Bit (DLAB). */
@@ -47,6 +55,14 @@
 /* Line Status Register. */
 #define LSR_DR 0x01             /* Data Ready: received data byte is in RBR. */
 #define LSR_THRE 0x20           /* THR Empty. */
+#define LSR_TEMT 0x40           /* Transmitter Empty: THR and shift reg. */
+
+/* Depth of the 16550A transmit FIFO.  Once THRE is set, the
+   whole FIFO is empty and may be refilled without polling. */
+#define FIFO_SIZE 16
+
+/* Default line speed, in bits per second. */
+#define DEFAULT_BPS 9600
 
 /* Transmission mode. */
 static enum { UNINIT, POLL, QUEUE } mode;
@@ -54,8 +70,16 @@ static enum { UNINIT, POLL, QUEUE } mode;
 /* Data to be transmitted. */
 static struct intq txq;
 
+/* Number of bytes we may write to THR each time THRE is set:
+   FIFO_SIZE if the UART has working FIFOs, otherwise 1. */
+static int tx_burst;
+
+/* Last value written to IER, to avoid redundant port writes. */
+static uint8_t ier_shadow;
+
 static void set_serial (int bps);
 static void putc_poll (uint8_t);
+static void drain_poll (void);
 static void write_ier (void);
 static intr_handler_func serial_interrupt;
 
@@ -68,8 +92,16 @@ init_poll (void)
 {
   ASSERT (mode == UNINIT);
   outb (IER_REG, 0);                    /* Turn off all interrupts. */
-  outb (FCR_REG, 0);                    /* Disable FIFO. */
-  set_serial (9600);                    /* 9.6 kbps, N-8-1. */
+  ier_shadow = 0;
+  outb (FCR_REG, FCR_ENABLE | FCR_CLEAR_RX | FCR_CLEAR_TX);
+  if ((inb (IIR_REG) & IIR_FIFO) == IIR_FIFO)
+    tx_burst = FIFO_SIZE;               /* 16550A with working FIFOs. */
+  else
+    {
+      outb (FCR_REG, 0);                /* 8250/16450/16550: no FIFO. */
+      tx_burst = 1;
+    }
+  set_serial (DEFAULT_BPS);             /* N-8-1. */
   outb (MCR_REG, MCR_OUT2);             /* Required to enable interrupts. */
   intq_init (&txq);
   mode = POLL;
@@ -117,9 +149,9 @@ serial_putc (uint8_t byte)
           /* Interrupts are off and the transmit queue is full.
              If we wanted to wait for the queue to empty,
              we'd have to reenable interrupts.
-             That's impolite, so we'll send a character via
-             polling instead. */
-          putc_poll (intq_getc (&txq)); 
+             That's impolite, so we'll make room by pushing a
+             burst of characters out via polling instead. */
+          drain_poll (); 
         }
 
       intq_putc (&txq, byte); 
@@ -136,7 +168,29 @@ serial_flush (void)
 {
   enum intr_level old_level = intr_disable ();
   while (!intq_empty (&txq))
-    putc_poll (intq_getc (&txq));
+    drain_poll ();
+  intr_set_level (old_level);
+}
+
+/* Changes the line speed to BPS bits per second, which must be
+   a divisor of 115200 no smaller than 300.  Any output already
+   accepted by the UART is sent at the old speed first.
+   Controlled by kernel command-line option "-baud". */
+void
+serial_set_speed (int bps)
+{
+  enum intr_level old_level = intr_disable ();
+
+  if (mode == UNINIT)
+    init_poll ();
+  else
+    {
+      serial_flush ();
+      while ((inb (LSR_REG) & LSR_TEMT) == 0)
+        continue;
+    }
+  set_serial (bps);
+
   intr_set_level (old_level);
 }
 
@@ -172,7 +226,9 @@ set_serial (int bps)
   outb (LCR_REG, LCR_N81);
 }
 
-/* Update interrupt enable register. */
+/* Update interrupt enable register.
+   Writing IER is a comparatively slow port access, especially
+   under emulation, so we skip it when nothing changed. */
 static void
 write_ier (void) 
 {
@@ -190,7 +246,11 @@ write_ier (void)
   if (!input_full ())
     ier |= IER_RECV;
   
-  outb (IER_REG, ier);
+  if (ier != ier_shadow)
+    {
+      ier_shadow = ier;
+      outb (IER_REG, ier);
+    }
 }
 
 /* Polls the serial port until it's ready,
@@ -205,6 +265,21 @@ putc_poll (uint8_t byte)
   outb (THR_REG, byte);
 }
 
+/* Polls the serial port until its transmitter is ready, and then
+   moves as much of the transmit queue into it as it will hold. */
+static void
+drain_poll (void)
+{
+  int i;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while ((inb (LSR_REG) & LSR_THRE) == 0)
+    continue;
+  for (i = 0; i < tx_burst && !intq_empty (&txq); i++)
+    outb (THR_REG, intq_getc (&txq));
+}
+
 /* Serial interrupt handler. */
 static void
 serial_interrupt (struct intr_frame *f UNUSED) 
@@ -218,10 +293,16 @@ serial_interrupt (struct intr_frame *f UNUSED)
   while (!input_full () && (inb (LSR_REG) & LSR_DR) != 0)
     input_putc (inb (RBR_REG));
 
-  /* As long as we have a byte to transmit, and the hardware is
-     ready to accept a byte for transmission, transmit a byte. */
-  while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0) 
-    outb (THR_REG, intq_getc (&txq));
+  /* If the transmitter is empty, refill it from the queue.  With
+     FIFOs enabled an empty THR means the whole FIFO is free, so
+     we can send a burst of bytes for the price of one
+     interrupt. */
+  if (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0)
+    {
+      int i;
+      for (i = 0; i < tx_burst && !intq_empty (&txq); i++)
+        outb (THR_REG, intq_getc (&txq));
+    }
 
   /* Update interrupt enable register based on queue status. */
   write_ier ();
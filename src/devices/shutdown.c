@@ -13,6 +13,9 @@
 #include "devices/block.h"
 #include "filesys/filesys.h"
 #endif
+#ifdef VM
+#include "vm/zswap.h"
+#endif
 
 /* Keyboard control register port. */
 #define CONTROL_REG 0x64
@@ -56,7 +59,8 @@ shutdown_configure (enum shutdown_type type)
 void
 shutdown_reboot (void)
 {
-  printf ("Rebooting...\n");
+  klog (KLOG_INFO, "Rebooting...");
+  console_flush ();
 
     /* See [kbd] for details on how to program the keyboard
      * controller. */
@@ -96,7 +100,8 @@ shutdown_power_off (void)
 
   print_stats ();
 
-  printf ("Powering off...\n");
+  klog (KLOG_INFO, "Powering off...");
+  console_flush ();
   serial_flush ();
 
   /* This is a special power-off sequence supported by Bochs and
@@ -110,7 +115,8 @@ shutdown_power_off (void)
   asm volatile ("cli; hlt" : : : "memory");
 
   /* None of those worked. */
-  printf ("still running...\n");
+  klog (KLOG_ERR, "still running...");
+  console_flush ();
   for (;;);
 }
 
@@ -128,4 +134,7 @@ print_stats (void)
 #ifdef USERPROG
   exception_print_stats ();
 #endif
+#ifdef VM
+  zswap_print_stats ();
+#endif
 }
@@ -1,4 +1,5 @@
 #include "devices/timer.h"
+#include <console.h>
 #include <debug.h>
 #include <inttypes.h>
 #include <round.h>
@@ -210,6 +211,7 @@ timer_interrupt (struct intr_frame *args UNUSED)
 {
   ticks++;
   thread_tick();
+  console_tick ();
 
   struct list_elem *e = list_begin(&sleeping_threads);
   struct thread_timer *current;
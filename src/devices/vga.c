@@ -14,21 +14,56 @@
 #define COL_CNT 80
 #define ROW_CNT 25
 
+/* Number of rows that fit in the 32 kB of text-mode video
+   memory at 0xb8000.  The display shows ROW_CNT consecutive rows
+   of these, starting at row `origin'. */
+#define VRAM_ROWS (0x8000 / (COL_CNT * 2))
+
+/* CRT Controller registers.  See [FREEVGA] under "CRT
+   Controller Registers". */
+#define CRTC_INDEX 0x3d4        /* Index register. */
+#define CRTC_DATA 0x3d5         /* Data register. */
+#define CRTC_START_HI 0x0c      /* Start Address High. */
+#define CRTC_START_LO 0x0d      /* Start Address Low. */
+#define CRTC_CURSOR_HI 0x0e     /* Cursor Location High. */
+#define CRTC_CURSOR_LO 0x0f     /* Cursor Location Low. */
+
 /* Current cursor position.  (0,0) is in the upper left corner of
    the display. */
 static size_t cx, cy;
 
+/* Video memory row displayed at the top of the screen.  Instead
+   of moving the whole screen up one line to scroll, we advance
+   this and point the CRTC start address at it. */
+static size_t origin;
+
+/* Cursor location last written to the CRTC, as an offset in
+   characters from the start of video memory. */
+static uint16_t hw_cursor;
+
 /* Attribute value for gray text on a black background. */
 #define GRAY_ON_BLACK 0x07
 
 /* Framebuffer.  See [FREEVGA] under "VGA Text Mode Operation".
-   The character at (x,y) is fb[y][x][0].
-   The attribute at (x,y) is fb[y][x][1]. */
+   The character at video memory row Y, column X is fb[Y][x][0].
+   The attribute at that position is fb[Y][x][1].  The screen
+   row y is video memory row origin + y. */
 static uint8_t (*fb)[COL_CNT][2];
 
+/* Copy of the visible screen in ordinary memory, kept as a ring
+   of rows: screen row y is shadow[(shadow_top + y) % ROW_CNT].
+   When `origin' reaches the end of video memory we rewrite the
+   screen at the start of video memory from here, because
+   reading video memory back is slow. */
+static uint8_t shadow[ROW_CNT][COL_CNT][2];
+static size_t shadow_top;
+
+static void putc_raw (int c, enum intr_level);
+static void put_cell (size_t x, size_t y, uint8_t c);
 static void clear_row (size_t y);
 static void cls (void);
 static void newline (void);
+static void set_origin (size_t);
 static void move_cursor (void);
 static void find_cursor (size_t *x, size_t *y);
 
@@ -40,9 +75,14 @@ init (void)
   static bool inited;
   if (!inited)
     {
+      size_t y;
+
       fb = ptov (0xb8000);
       find_cursor (&cx, &cy);
-      inited = true; 
+      set_origin (0);
+      for (y = 0; y < ROW_CNT; y++)
+        memcpy (shadow[y], fb[y], sizeof shadow[y]);
+      inited = true;
     }
 }
 
@@ -56,8 +96,37 @@ vga_putc (int c)
   enum intr_level old_level = intr_disable ();
 
   init ();
-  
-  switch (c) 
+  putc_raw (c, old_level);
+
+  /* Update cursor position. */
+  move_cursor ();
+
+  intr_set_level (old_level);
+}
+
+/* Writes the N characters in BUFFER to the VGA text display, as
+   vga_putc() would, but only moves the hardware cursor once at
+   the end. */
+void
+vga_putbuf (const char *buffer, size_t n)
+{
+  enum intr_level old_level = intr_disable ();
+
+  init ();
+  while (n-- > 0)
+    putc_raw (*buffer++, old_level);
+  move_cursor ();
+
+  intr_set_level (old_level);
+}
+
+/* Writes C to the display at the cursor without updating the
+   hardware cursor.  Interrupts must be off; OLD_LEVEL is the
+   level to return to while beeping. */
+static void
+putc_raw (int c, enum intr_level old_level)
+{
+  switch (c)
     {
     case '\n':
       newline ();
@@ -71,7 +140,7 @@ vga_putc (int c)
       if (cx > 0)
         cx--;
       break;
-      
+
     case '\r':
       cx = 0;
       break;
@@ -87,50 +156,58 @@ vga_putc (int c)
       speaker_beep ();
       intr_disable ();
       break;
-      
+
     default:
-      fb[cy][cx][0] = c;
-      fb[cy][cx][1] = GRAY_ON_BLACK;
+      put_cell (cx, cy, c);
       if (++cx >= COL_CNT)
         newline ();
       break;
     }
+}
 
-  /* Update cursor position. */
-  move_cursor ();
+/* Stores character C, in gray on black, at screen position
+   (X,Y) in both video memory and the shadow copy. */
+static void
+put_cell (size_t x, size_t y, uint8_t c)
+{
+  uint8_t *cell = shadow[(shadow_top + y) % ROW_CNT][x];
 
-  intr_set_level (old_level);
+  fb[origin + y][x][0] = cell[0] = c;
+  fb[origin + y][x][1] = cell[1] = GRAY_ON_BLACK;
 }
-
+
 /* Clears the screen and moves the cursor to the upper left. */
 static void
 cls (void)
 {
   size_t y;
 
+  set_origin (0);
   for (y = 0; y < ROW_CNT; y++)
     clear_row (y);
 
   cx = cy = 0;
-  move_cursor ();
 }
 
-/* Clears row Y to spaces. */
+/* Clears screen row Y to spaces. */
 static void
-clear_row (size_t y) 
+clear_row (size_t y)
 {
   size_t x;
 
   for (x = 0; x < COL_CNT; x++)
-    {
-      fb[y][x][0] = ' ';
-      fb[y][x][1] = GRAY_ON_BLACK;
-    }
+    put_cell (x, y, ' ');
 }
 
 /* Advances the cursor to the first column in the next line on
    the screen.  If the cursor is already on the last line on the
-   screen, scrolls the screen upward one line. */
+   screen, scrolls the screen upward one line.
+
+   Scrolling normally just moves the CRTC start address down by
+   one row, which costs a row's worth of clearing instead of a
+   screen's worth of copying.  Once the visible rows reach the end
+   of video memory, we rewrite them at its start from the shadow
+   copy, once every VRAM_ROWS - ROW_CNT lines. */
 static void
 newline (void)
 {
@@ -138,35 +215,68 @@ newline (void)
   cy++;
   if (cy >= ROW_CNT)
     {
+      size_t wrap;
+
       cy = ROW_CNT - 1;
-      memmove (&fb[0], &fb[1], sizeof fb[0] * (ROW_CNT - 1));
+      shadow_top = (shadow_top + 1) % ROW_CNT;
+      if (origin + ROW_CNT < VRAM_ROWS)
+        set_origin (origin + 1);
+      else
+        {
+          /* Screen rows 0...ROW_CNT - 2 are the shadow rows from
+             shadow_top up, wrapping around at WRAP. */
+          wrap = ROW_CNT - shadow_top;
+          if (wrap > ROW_CNT - 1)
+            wrap = ROW_CNT - 1;
+          memcpy (&fb[0], &shadow[shadow_top], sizeof shadow[0] * wrap);
+          memcpy (&fb[wrap], &shadow[0],
+                  sizeof shadow[0] * (ROW_CNT - 1 - wrap));
+          set_origin (0);
+        }
       clear_row (ROW_CNT - 1);
     }
 }
 
-/* Moves the hardware cursor to (cx,cy). */
+/* Makes video memory row ORIGIN the top row of the display. */
+static void
+set_origin (size_t new_origin)
+{
+  /* See [FREEVGA] under "CRT Controller Registers". */
+  uint16_t start = new_origin * COL_CNT;
+
+  origin = new_origin;
+  outw (CRTC_INDEX, CRTC_START_HI | (start & 0xff00));
+  outw (CRTC_INDEX, CRTC_START_LO | (start << 8));
+}
+
+/* Moves the hardware cursor to (cx,cy), unless it is already
+   there. */
 static void
-move_cursor (void) 
+move_cursor (void)
 {
   /* See [FREEVGA] under "Manipulating the Text-mode Cursor". */
-  uint16_t cp = cx + COL_CNT * cy;
-  outw (0x3d4, 0x0e | (cp & 0xff00));
-  outw (0x3d4, 0x0f | (cp << 8));
+  uint16_t cp = cx + COL_CNT * (origin + cy);
+  if (cp == hw_cursor)
+    return;
+  hw_cursor = cp;
+  outw (CRTC_INDEX, CRTC_CURSOR_HI | (cp & 0xff00));
+  outw (CRTC_INDEX, CRTC_CURSOR_LO | (cp << 8));
 }
 
 /* Reads the current hardware cursor position into (*X,*Y). */
 static void
-find_cursor (size_t *x, size_t *y) 
+find_cursor (size_t *x, size_t *y)
 {
   /* See [FREEVGA] under "Manipulating the Text-mode Cursor". */
   uint16_t cp;
 
-  outb (0x3d4, 0x0e);
-  cp = inb (0x3d5) << 8;
+  outb (CRTC_INDEX, CRTC_CURSOR_HI);
+  cp = inb (CRTC_DATA) << 8;
 
-  outb (0x3d4, 0x0f);
-  cp |= inb (0x3d5);
+  outb (CRTC_INDEX, CRTC_CURSOR_LO);
+  cp |= inb (CRTC_DATA);
 
+  hw_cursor = cp;
   *x = cp % COL_CNT;
   *y = cp / COL_CNT;
 }
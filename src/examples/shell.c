@@ -1,3 +1,4 @@
+#include <fcntl.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
@@ -5,6 +6,7 @@
 
 static void read_line (char line[], size_t);
 static bool backspace (char **pos, char line[]);
+static void run_pipeline (char *command);
 
 int
 main (void)
@@ -31,19 +33,114 @@ main (void)
           /* Empty command. */
         }
       else
-        {
-          pid_t pid = exec (command);
-          if (pid != PID_ERROR)
-            printf ("\"%s\": exit code %d\n", command, wait (pid));
-          else
-            printf ("exec failed\n");
-        }
+        run_pipeline (command);
     }
 
   printf ("Shell exiting.");
   return EXIT_SUCCESS;
 }
 
+/* Maximum number of commands in a pipeline. */
+#define MAX_STAGES 8
+
+/* Runs COMMAND, which may be several commands separated by `|',
+   each of which reads the output of the one before it.  All of
+   them run at once, connected by pipes.  Then waits for each one
+   and reports its exit code. */
+static void
+run_pipeline (char *command) 
+{
+  char *stages[MAX_STAGES];
+  pid_t pids[MAX_STAGES];
+  int stage_cnt = 0;
+  int saved_in = -1, saved_out = -1;
+  int in = -1;
+  bool pipe_failed = false;
+  char *stage, *save_ptr;
+  int i;
+
+  /* Split COMMAND into stages, trimming spaces around each. */
+  for (stage = strtok_r (command, "|", &save_ptr); stage != NULL;
+       stage = strtok_r (NULL, "|", &save_ptr))
+    {
+      char *end;
+
+      if (stage_cnt >= MAX_STAGES) 
+        {
+          printf ("too many commands in pipeline\n");
+          return;
+        }
+      while (*stage == ' ')
+        stage++;
+      for (end = stage + strlen (stage); end > stage && end[-1] == ' '; end--)
+        continue;
+      *end = '\0';
+      stages[stage_cnt++] = stage;
+    }
+
+  /* Start each stage with its standard input and output pointed
+     at the pipes on either side of it.  A child inherits our
+     file descriptors, so we point our own at the pipes while we
+     start it, and afterward put back the console, which we keep
+     copies of in the meantime.  Those copies, and the read end
+     of a pipe waiting for the next stage, are marked close-on-exec
+     so that the children do not inherit them. */
+  if (stage_cnt > 1) 
+    {
+      saved_in = dup (STDIN_FILENO);
+      saved_out = dup (STDOUT_FILENO);
+      fcntl (saved_in, F_SETFD, FD_CLOEXEC);
+      fcntl (saved_out, F_SETFD, FD_CLOEXEC);
+    }
+  for (i = 0; i < stage_cnt; i++) 
+    {
+      int fds[2] = {-1, -1};
+
+      if (i + 1 < stage_cnt && pipe (fds) < 0) 
+        {
+          pipe_failed = true;
+          stage_cnt = i;
+          break;
+        }
+      if (fds[0] >= 0)
+        fcntl (fds[0], F_SETFD, FD_CLOEXEC);
+      if (in >= 0) 
+        {
+          dup2 (in, STDIN_FILENO);
+          close (in);
+        }
+      if (fds[1] >= 0) 
+        {
+          dup2 (fds[1], STDOUT_FILENO);
+          close (fds[1]);
+        }
+      else if (saved_out >= 0)
+        dup2 (saved_out, STDOUT_FILENO);
+
+      pids[i] = exec (stages[i]);
+      in = fds[0];
+    }
+  if (in >= 0)
+    close (in);
+  if (saved_in >= 0) 
+    {
+      dup2 (saved_in, STDIN_FILENO);
+      dup2 (saved_out, STDOUT_FILENO);
+      close (saved_in);
+      close (saved_out);
+    }
+
+  if (pipe_failed)
+    printf ("pipe failed\n");
+
+  /* Wait for the stages. */
+  for (i = 0; i < stage_cnt; i++)
+    if (pids[i] != PID_ERROR)
+      printf ("\"%s\": exit code %d\n", stages[i], wait (pids[i]));
+    else
+      printf ("\"%s\": exec failed\n", stages[i]);
+}
+
 /* Reads a line of input from the user into LINE, which has room
    for SIZE bytes.  Handles backspace and Ctrl+U in the ways
    expected by Unix users.  On return, LINE will always be
@@ -113,6 +113,17 @@ file_write_at (struct file *file, const void *buffer, off_t size,
   return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Copies SIZE bytes from SRC into DST, starting at offset START
+   in both files, without passing the data through the caller.
+   Returns the number of bytes actually copied,
+   which may be less than SIZE if end of either file is reached.
+   The files' current positions are unaffected. */
+off_t
+file_copy_at (struct file *dst, struct file *src, off_t size, off_t start)
+{
+  return inode_copy_at (dst->inode, src->inode, size, start);
+}
+
 /* Prevents write operations on FILE's underlying inode
    until file_allow_write() is called or FILE is closed. */
 void
@@ -1,4 +1,5 @@
 #include "filesys/fsutil.h"
+#include <console.h>
 #include <debug.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -11,6 +12,13 @@
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
 
+/* Position on the scratch device where fsutil_append() and
+   fsutil_dumplog() write their next ustar entry. */
+static block_sector_t append_sector;
+
+static void append_buffer (const char *file_name, const char *data,
+                           off_t size);
+
 /* List files in the root directory. */
 void
 fsutil_ls (char **argv UNUSED) 
@@ -166,7 +174,7 @@ fsutil_extract (char **argv UNUSED)
 void
 fsutil_append (char **argv)
 {
-  static block_sector_t sector = 0;
+  block_sector_t sector = append_sector;
 
   const char *file_name = argv[1];
   void *buffer;
@@ -218,6 +226,66 @@ fsutil_append (char **argv)
   block_write (dst, sector, buffer + 1);
 
   /* Finish up. */
+  append_sector = sector;
   file_close (src);
   free (buffer);
 }
+
+/* Copies the kernel log to the scratch device as a file named
+   "klog", in ustar format, at the same position that
+   fsutil_append() would use. */
+void
+fsutil_dumplog (char **argv UNUSED)
+{
+  char *log;
+  size_t size;
+
+  log = palloc_get_multiple (PAL_ASSERT, KLOG_PAGES);
+  size = klog_read (log, KLOG_PAGES * PGSIZE);
+  printf ("Appending %zu bytes of kernel log to ustar archive "
+          "on scratch device...\n", size);
+  append_buffer ("klog", log, size);
+  palloc_free_multiple (log, KLOG_PAGES);
+}
+
+/* Writes SIZE bytes from DATA to the scratch device as a ustar
+   entry named FILE_NAME, followed by an end-of-archive marker,
+   and advances the append position past the entry. */
+static void
+append_buffer (const char *file_name, const char *data, off_t size)
+{
+  block_sector_t sector = append_sector;
+  char *buffer;
+  struct block *dst;
+
+  buffer = malloc (BLOCK_SECTOR_SIZE);
+  if (buffer == NULL)
+    PANIC ("couldn't allocate buffer");
+
+  dst = block_get_role (BLOCK_SCRATCH);
+  if (dst == NULL)
+    PANIC ("couldn't open scratch device");
+
+  if (!ustar_make_header (file_name, USTAR_REGULAR, size, buffer))
+    PANIC ("%s: name too long for ustar format", file_name);
+  block_write (dst, sector++, buffer);
+
+  while (size > 0) 
+    {
+      int chunk_size = size > BLOCK_SECTOR_SIZE ? BLOCK_SECTOR_SIZE : size;
+      if (sector >= block_size (dst))
+        PANIC ("%s: out of space on scratch device", file_name);
+      memcpy (buffer, data, chunk_size);
+      memset (buffer + chunk_size, 0, BLOCK_SECTOR_SIZE - chunk_size);
+      block_write (dst, sector++, buffer);
+      data += chunk_size;
+      size -= chunk_size;
+    }
+
+  memset (buffer, 0, BLOCK_SECTOR_SIZE);
+  block_write (dst, sector, buffer);
+  block_write (dst, sector + 1, buffer);
+
+  append_sector = sector;
+  free (buffer);
+}
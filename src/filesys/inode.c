@@ -36,6 +36,7 @@ struct inode
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+    unsigned version;                   /* Incremented by each write. */
     struct inode_disk data;             /* Inode content. */
   };
 
@@ -136,6 +137,7 @@ inode_open (block_sector_t sector)
   inode->sector = sector;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
+  inode->version = 0;
   inode->removed = false;
   block_read (fs_device, inode->sector, &inode->data);
   return inode;
@@ -264,6 +266,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 
   if (inode->deny_write_cnt)
     return 0;
+  inode->version++;
 
   while (size > 0) 
     {
@@ -317,6 +320,82 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
   return bytes_written;
 }
 
+/* Number of sectors that inode_copy_at() moves at a time. */
+#define COPY_SECTORS 16
+
+/* Copies SIZE bytes from SRC to DST, both starting at OFFSET.
+   Returns the number of bytes actually copied, which may be less
+   than SIZE if end of either file is reached or an error occurs.
+
+   The data of both inodes is contiguous on disk, so whole
+   sectors move in runs of up to COPY_SECTORS with a single
+   multi-sector read and write each.  Only partial sectors at the
+   ends of the range go through inode_read_at() and
+   inode_write_at(). */
+off_t
+inode_copy_at (struct inode *dst, struct inode *src, off_t size,
+               off_t offset)
+{
+  off_t bytes_copied = 0;
+  off_t src_left, dst_left;
+  uint8_t *buffer;
+
+  if (dst->deny_write_cnt)
+    return 0;
+  dst->version++;
+
+  /* Stop at the end of either file. */
+  src_left = inode_length (src) - offset;
+  dst_left = inode_length (dst) - offset;
+  if (size > src_left)
+    size = src_left;
+  if (size > dst_left)
+    size = dst_left;
+  if (size <= 0)
+    return 0;
+
+  buffer = malloc (COPY_SECTORS * BLOCK_SECTOR_SIZE);
+  if (buffer == NULL)
+    return 0;
+
+  while (size > 0)
+    {
+      int sector_ofs = offset % BLOCK_SECTOR_SIZE;
+      off_t chunk_size;
+
+      if (sector_ofs == 0 && size >= BLOCK_SECTOR_SIZE)
+        {
+          /* Copy a run of whole sectors. */
+          size_t cnt = size / BLOCK_SECTOR_SIZE;
+          if (cnt > COPY_SECTORS)
+            cnt = COPY_SECTORS;
+          block_read_multiple (fs_device, byte_to_sector (src, offset),
+                               cnt, buffer);
+          block_write_multiple (fs_device, byte_to_sector (dst, offset),
+                                cnt, buffer);
+          chunk_size = cnt * BLOCK_SECTOR_SIZE;
+        }
+      else
+        {
+          /* Copy part of a sector. */
+          chunk_size = BLOCK_SECTOR_SIZE - sector_ofs;
+          if (chunk_size > size)
+            chunk_size = size;
+          if (inode_read_at (src, buffer, chunk_size, offset) != chunk_size
+              || inode_write_at (dst, buffer, chunk_size, offset) != chunk_size)
+            break;
+        }
+
+      /* Advance. */
+      size -= chunk_size;
+      offset += chunk_size;
+      bytes_copied += chunk_size;
+    }
+  free (buffer);
+
+  return bytes_copied;
+}
+
 /* Disables writes to INODE.
    May be called at most once per inode opener. */
 void
@@ -337,6 +416,15 @@ inode_allow_write (struct inode *inode)
   inode->deny_write_cnt--;
 }
 
+/* Returns a number that changes whenever INODE's data is
+   written, so that a copy of the data made while it had one
+   value is up to date as long as it keeps it. */
+unsigned
+inode_version (const struct inode *inode)
+{
+  return inode->version;
+}
+
 /* Returns the length, in bytes, of INODE's data. */
 off_t
 inode_length (const struct inode *inode)
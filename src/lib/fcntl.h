@@ -0,0 +1,11 @@
+#ifndef __LIB_FCNTL_H
+#define __LIB_FCNTL_H
+
+/* Commands for fcntl(). */
+#define F_GETFD 1               /* Get file descriptor flags. */
+#define F_SETFD 2               /* Set file descriptor flags. */
+
+/* File descriptor flags. */
+#define FD_CLOEXEC 1            /* Close the descriptor on exec. */
+
+#endif /* lib/fcntl.h */
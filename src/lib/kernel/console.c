@@ -1,14 +1,27 @@
 #include <console.h>
+#include <inttypes.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
+#include <uio.h>
 #include "devices/serial.h"
+#include "devices/timer.h"
 #include "devices/vga.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
 
+static void acquire_console (void);
+static void release_console (void);
 static void vprintf_helper (char, void *);
 static void putchar_have_lock (uint8_t c);
+static void log_write (const char *, size_t);
+static void emit (const char *, size_t);
+static void drain (size_t max);
+static thread_func drain_thread NO_RETURN;
 
 /* The console lock.
    Both the vga and serial layers do their own locking, so it's
@@ -59,6 +72,41 @@ static int console_lock_depth;
 /* Number of characters written to console. */
 static int64_t write_cnt;
 
+/* The kernel log.
+
+   Once console_init_drain() has run, console output no longer
+   goes straight to the serial port and VGA display.  Instead,
+   writers append it to an in-memory ring, which takes only a
+   moment with interrupts disabled, and a background "klogd"
+   thread copies it out to the devices in chunks.  A thread that
+   prints therefore never waits for the serial port unless the
+   ring is full.
+
+   The ring also keeps the most recent LOG_SIZE bytes of output
+   around after they have been displayed, so that the "dumplog"
+   action can save them, and it holds klog() records that are
+   above klog_console_level.  Such "quiet" records begin with
+   QUIET_MARK and end with a new-line; they are stored but
+   never displayed. */
+#define LOG_SIZE (KLOG_PAGES * PGSIZE)  /* Ring size in bytes. */
+#define DRAIN_CHUNK 256                 /* Max bytes klogd moves at once. */
+#define QUIET_MARK '\001'               /* Starts a quiet record. */
+
+static char *log_buf;           /* Ring buffer, null until drain starts. */
+static uint32_t log_head;       /* Number of bytes ever appended. */
+static uint32_t log_tail;       /* Number of bytes handed to devices. */
+static bool log_direct;         /* Bypass the ring (after a panic)? */
+static bool emit_quiet;         /* emit() is inside a quiet record? */
+
+static struct lock drain_lock;  /* Serializes draining between threads. */
+static struct semaphore drain_sema;     /* Up'd to wake klogd. */
+static bool drain_asleep;       /* klogd is waiting on drain_sema? */
+
+/* klog() records above this level are kept in the log but not
+   displayed.  Controlled by kernel command-line option
+   "-loglevel". */
+enum klog_level klog_console_level = KLOG_INFO;
+
 /* Enable console locking. */
 void
 console_init (void) 
@@ -67,13 +115,114 @@ console_init (void)
   use_console_lock = true;
 }
 
+/* Starts buffering console output in the kernel log and the
+   thread that drains it.  Must be called after thread_start(). */
+void
+console_init_drain (void) 
+{
+  lock_init (&drain_lock);
+  sema_init (&drain_sema, 0);
+  log_buf = palloc_get_multiple (PAL_ASSERT, KLOG_PAGES);
+  thread_create ("klogd", PRI_DEFAULT, drain_thread, NULL);
+}
+
 /* Notifies the console that a kernel panic is underway,
    which warns it to avoid trying to take the console lock from
-   now on. */
+   now on.  Anything still in the kernel log is written out
+   immediately, and later output bypasses the log, because klogd
+   will never run again. */
 void
 console_panic (void) 
 {
   use_console_lock = false;
+  if (!log_direct)
+    {
+      log_direct = true;
+      drain (SIZE_MAX);
+    }
+}
+
+/* Writes everything in the kernel log out to the devices and
+   waits for it to finish, e.g. before the machine shuts down. */
+void
+console_flush (void) 
+{
+  if (!intr_context () && intr_get_level () == INTR_ON && log_buf != NULL)
+    {
+      lock_acquire (&drain_lock);
+      drain (SIZE_MAX);
+      lock_release (&drain_lock);
+    }
+  else
+    drain (SIZE_MAX);
+}
+
+/* Appends a record to the kernel log, stamped with the current
+   timer tick, and displays it if LEVEL is no higher than
+   klog_console_level.  A new-line is supplied if FORMAT does not
+   end in one.  Records longer than about 200 bytes are
+   truncated. */
+void
+klog (enum klog_level level, const char *format, ...) 
+{
+  static const char *level_names[] = {"error", "warning", "info", "debug"};
+  char record[224];
+  bool quiet = level > klog_console_level;
+  va_list args;
+  size_t n;
+
+  ASSERT (level >= KLOG_ERR && level <= KLOG_DEBUG);
+
+  /* With no log to keep them in, quiet records are dropped. */
+  if (quiet && (log_buf == NULL || log_direct))
+    return;
+
+  n = snprintf (record, sizeof record, "%s[%"PRId64"] %s: ",
+                quiet ? "\001" : "", timer_ticks (), level_names[level]);
+  va_start (args, format);
+  vsnprintf (record + n, sizeof record - n, format, args);
+  va_end (args);
+  n = strlen (record);
+  if (n == sizeof record - 1 || record[n - 1] != '\n')
+    {
+      if (n == sizeof record - 1)
+        n--;
+      record[n++] = '\n';
+    }
+
+  acquire_console ();
+  if (!quiet)
+    write_cnt += n;
+  log_write (record, n);
+  release_console ();
+}
+
+/* Copies the most recent output in the kernel log, up to SIZE
+   bytes of it, into DST, leaving out the markers of quiet
+   records.  Returns the number of bytes copied. */
+size_t
+klog_read (char *dst, size_t size) 
+{
+  enum intr_level old_level;
+  uint32_t start, ofs;
+  size_t n = 0;
+
+  if (log_buf == NULL)
+    return 0;
+
+  old_level = intr_disable ();
+  start = log_head - (log_head < LOG_SIZE ? log_head : LOG_SIZE);
+  if (log_head - start > size)
+    start = log_head - size;
+  for (ofs = start; ofs != log_head; ofs++)
+    {
+      char c = log_buf[ofs % LOG_SIZE];
+      if (c != QUIET_MARK)
+        dst[n++] = c;
+    }
+  intr_set_level (old_level);
+
+  return n;
 }
 
 /* Prints console statistics. */
@@ -153,8 +302,24 @@ void
 putbuf (const char *buffer, size_t n) 
 {
   acquire_console ();
-  while (n-- > 0)
-    putchar_have_lock (*buffer++);
+  write_cnt += n;
+  log_write (buffer, n);
+  release_console ();
+}
+
+/* Writes the CNT buffers in IOV to the console, in order, with
+   no other output between them. */
+void
+putbufv (const struct iovec *iov, int cnt)
+{
+  int i;
+
+  acquire_console ();
+  for (i = 0; i < cnt; i++)
+    {
+      write_cnt += iov[i].iov_len;
+      log_write (iov[i].iov_base, iov[i].iov_len);
+    }
   release_console ();
 }
 
@@ -184,8 +349,152 @@ vprintf_helper (char c, void *char_cnt_)
 static void
 putchar_have_lock (uint8_t c) 
 {
+  char ch = c;
+
   ASSERT (console_locked_by_current_thread ());
   write_cnt++;
-  serial_putc (c);
-  vga_putc (c);
+  log_write (&ch, 1);
+}
+
+/* Appends the N bytes in BUFFER to the kernel log and makes sure
+   that klogd will display them, or displays them directly if the
+   log is not in use.
+
+   If the ring is full, the oldest undisplayed bytes must be
+   written out to make room.  A thread that may sleep does that
+   under drain_lock, so its output stays in order with klogd's.
+   In an interrupt handler or with interrupts off we cannot
+   sleep, so we write them out directly; that can put them ahead
+   of a chunk that klogd is still sending, but never loses
+   them. */
+static void
+log_write (const char *buffer, size_t n) 
+{
+  enum intr_level old_level;
+  bool can_sleep;
+
+  if (log_buf == NULL || log_direct)
+    {
+      emit (buffer, n);
+      return;
+    }
+
+  can_sleep = !intr_context () && intr_get_level () == INTR_ON;
+  old_level = intr_disable ();
+  while (n > 0) 
+    {
+      if (log_head - log_tail >= LOG_SIZE)
+        {
+          if (can_sleep)
+            {
+              intr_set_level (old_level);
+              lock_acquire (&drain_lock);
+              drain (DRAIN_CHUNK);
+              lock_release (&drain_lock);
+              intr_disable ();
+            }
+          else
+            drain (DRAIN_CHUNK);
+          continue;
+        }
+
+      log_buf[log_head++ % LOG_SIZE] = *buffer++;
+      n--;
+    }
+
+  /* Waking klogd can yield the CPU, so we only do it when that
+     is harmless.  Otherwise, console_tick() wakes it up at the
+     first timer interrupt after interrupts are back on. */
+  if (drain_asleep && (intr_context () || old_level == INTR_ON))
+    {
+      drain_asleep = false;
+      sema_up (&drain_sema);
+    }
+  intr_set_level (old_level);
+}
+
+/* Wakes klogd if output is waiting for it.  Called by the timer
+   interrupt handler, for output written with interrupts off
+   outside an interrupt handler, which log_write() could not wake
+   klogd for. */
+void
+console_tick (void)
+{
+  ASSERT (intr_context ());
+  if (drain_asleep && log_tail != log_head)
+    {
+      drain_asleep = false;
+      sema_up (&drain_sema);
+    }
+}
+
+/* Writes up to MAX of the oldest undisplayed bytes in the kernel
+   log to the devices.  Bytes leave the ring before they are
+   written, so that writers can refill it meanwhile. */
+static void
+drain (size_t max) 
+{
+  char chunk[DRAIN_CHUNK];
+
+  if (log_buf == NULL)
+    return;
+
+  while (max > 0) 
+    {
+      enum intr_level old_level = intr_disable ();
+      size_t n = 0;
+      while (n < sizeof chunk && n < max && log_tail != log_head)
+        chunk[n++] = log_buf[log_tail++ % LOG_SIZE];
+      intr_set_level (old_level);
+
+      if (n == 0)
+        break;
+      emit (chunk, n);
+      max -= n;
+    }
+}
+
+/* Writes the N bytes in BUFFER to the serial port and the VGA
+   display, omitting quiet records. */
+static void
+emit (const char *buffer, size_t n) 
+{
+  const char *run = buffer;
+  const char *end = buffer + n;
+
+  for (; buffer < end; buffer++)
+    if (emit_quiet)
+      {
+        emit_quiet = *buffer != '\n';
+        run = buffer + 1;
+      }
+    else if (*buffer == QUIET_MARK)
+      {
+        vga_putbuf (run, buffer - run);
+        emit_quiet = true;
+      }
+    else
+      serial_putc (*buffer);
+  if (!emit_quiet)
+    vga_putbuf (run, buffer - run);
+}
+
+/* klogd: displays whatever is appended to the kernel log. */
+static void
+drain_thread (void *aux UNUSED) 
+{
+  for (;;) 
+    {
+      enum intr_level old_level = intr_disable ();
+      while (log_tail == log_head) 
+        {
+          drain_asleep = true;
+          sema_down (&drain_sema);
+        }
+      intr_set_level (old_level);
+
+      lock_acquire (&drain_lock);
+      drain (DRAIN_CHUNK);
+      lock_release (&drain_lock);
+    }
 }
@@ -1,8 +1,31 @@
 #ifndef __LIB_KERNEL_CONSOLE_H
 #define __LIB_KERNEL_CONSOLE_H
 
+#include <debug.h>
+#include <stddef.h>
+
+/* Kernel log levels, most to least severe. */
+enum klog_level
+  {
+    KLOG_ERR,                   /* Something failed. */
+    KLOG_WARN,                  /* Something looks wrong. */
+    KLOG_INFO,                  /* Normal but noteworthy. */
+    KLOG_DEBUG                  /* Only of interest when debugging. */
+  };
+
+/* Size of the kernel log, in pages. */
+#define KLOG_PAGES 16
+
+extern enum klog_level klog_console_level;
+
 void console_init (void);
+void console_init_drain (void);
 void console_panic (void);
+void console_flush (void);
+void console_tick (void);
 void console_print_stats (void);
 
+void klog (enum klog_level, const char *, ...) PRINTF_FORMAT (2, 3);
+size_t klog_read (char *, size_t);
+
 #endif /* lib/kernel/console.h */
@@ -0,0 +1,220 @@
+/* LZ77-class compression.
+
+   A compressed block is a sequence of sequences.  Each sequence
+   is a token byte, then a run of literal bytes copied to the
+   output as is, then a match: a 2-byte little-endian offset back
+   into the output, from which to copy.  The token's high nibble
+   is the number of literals, and its low nibble is the match
+   length minus MIN_MATCH.  A nibble of 15 means that more of the
+   length follows, as bytes that are added on, up to and
+   including the first that is less than 255.  The last sequence
+   ends after its literals, with no match. */
+
+#include "lz.h"
+#include <debug.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Shortest match worth encoding. */
+#define MIN_MATCH 4
+
+/* Farthest back that a match can reach. */
+#define MAX_OFFSET 0xffff
+
+/* The compressor remembers the last position at which it saw
+   each of HASH_CNT hashes of MIN_MATCH bytes. */
+#define HASH_CNT (LZ_WORK_SIZE / sizeof (uint16_t))
+
+static uint8_t *put_sequence (uint8_t *op, uint8_t *op_end,
+                              const uint8_t *lit, size_t lit_cnt,
+                              size_t offset, size_t match_len);
+static uint8_t *put_length (uint8_t *op, uint8_t *op_end, size_t len);
+static bool get_length (const uint8_t **ip, const uint8_t *end,
+                        size_t *len);
+
+/* Returns the 4 bytes at P as a word. */
+static inline uint32_t
+read32 (const uint8_t *p)
+{
+  uint32_t x;
+  memcpy (&x, p, sizeof x);
+  return x;
+}
+
+/* Hashes the 4 bytes in X into [0, HASH_CNT). */
+static inline unsigned
+hash4 (uint32_t x)
+{
+  return (x * 2654435761u) >> 21 & (HASH_CNT - 1);
+}
+
+/* Compresses the SIZE bytes at SRC into the DST_SIZE bytes at
+   DST, using the LZ_WORK_SIZE bytes at WORK as scratch space.
+   Returns the compressed size, or 0 if it would exceed DST_SIZE,
+   that is, if the data does not compress to DST_SIZE bytes. */
+size_t
+lz_compress (const void *src_, size_t size, void *dst_, size_t dst_size,
+             void *work)
+{
+  const uint8_t *src = src_;
+  const uint8_t *end = src + size;
+  const uint8_t *ip = src;
+  const uint8_t *anchor = src;
+  uint8_t *op = dst_;
+  uint8_t *op_end = op + dst_size;
+  uint16_t *table = work;
+
+  ASSERT (size <= 0x10000);
+
+  memset (table, 0, LZ_WORK_SIZE);
+  while (end - ip >= MIN_MATCH)
+    {
+      uint32_t seq = read32 (ip);
+      unsigned h = hash4 (seq);
+      const uint8_t *cand = src + table[h];
+
+      table[h] = ip - src;
+      if (cand < ip && ip - cand <= MAX_OFFSET && read32 (cand) == seq)
+        {
+          size_t len = MIN_MATCH;
+          while (ip + len < end && ip[len] == cand[len])
+            len++;
+
+          op = put_sequence (op, op_end, anchor, ip - anchor, ip - cand, len);
+          if (op == NULL)
+            return 0;
+          ip += len;
+          anchor = ip;
+        }
+      else
+        ip++;
+    }
+
+  op = put_sequence (op, op_end, anchor, end - anchor, 0, 0);
+  return op != NULL ? op - (uint8_t *) dst_ : 0;
+}
+
+/* Appends to the output at OP, which ends at OP_END, a sequence
+   of the LIT_CNT literal bytes at LIT followed by a copy of
+   MATCH_LEN bytes from OFFSET bytes back, or no match if
+   MATCH_LEN is 0.  Returns the new end of the output, or a null
+   pointer if it does not fit. */
+static uint8_t *
+put_sequence (uint8_t *op, uint8_t *op_end, const uint8_t *lit,
+              size_t lit_cnt, size_t offset, size_t match_len)
+{
+  size_t match_code = match_len > 0 ? match_len - MIN_MATCH : 0;
+  uint8_t *token = op++;
+
+  if (token >= op_end)
+    return NULL;
+  *token = ((lit_cnt < 15 ? lit_cnt : 15) << 4
+            | (match_code < 15 ? match_code : 15));
+
+  if (lit_cnt >= 15 && (op = put_length (op, op_end, lit_cnt - 15)) == NULL)
+    return NULL;
+  if ((size_t) (op_end - op) < lit_cnt)
+    return NULL;
+  memcpy (op, lit, lit_cnt);
+  op += lit_cnt;
+
+  if (match_len > 0)
+    {
+      if (op_end - op < 2)
+        return NULL;
+      *op++ = offset;
+      *op++ = offset >> 8;
+      if (match_code >= 15)
+        op = put_length (op, op_end, match_code - 15);
+    }
+  return op;
+}
+
+/* Appends the extra length bytes for LEN at OP, which ends at
+   OP_END.  Returns the new end of the output, or a null pointer
+   if it does not fit. */
+static uint8_t *
+put_length (uint8_t *op, uint8_t *op_end, size_t len)
+{
+  for (;;)
+    {
+      if (op >= op_end)
+        return NULL;
+      if (len < 255)
+        {
+          *op++ = len;
+          return op;
+        }
+      *op++ = 255;
+      len -= 255;
+    }
+}
+
+/* Decompresses the SIZE bytes at SRC, produced by lz_compress(),
+   into the DST_SIZE bytes at DST.  Returns the number of bytes
+   produced, or LZ_ERROR if SRC is not well formed or the output
+   would exceed DST_SIZE. */
+size_t
+lz_decompress (const void *src_, size_t size, void *dst_, size_t dst_size)
+{
+  const uint8_t *ip = src_;
+  const uint8_t *end = ip + size;
+  uint8_t *dst = dst_;
+  uint8_t *op = dst;
+  uint8_t *op_end = dst + dst_size;
+
+  while (ip < end)
+    {
+      unsigned token = *ip++;
+      size_t lit_cnt = token >> 4;
+      size_t match_len = token & 15;
+      size_t offset;
+
+      /* Literals. */
+      if (lit_cnt == 15 && !get_length (&ip, end, &lit_cnt))
+        return LZ_ERROR;
+      if ((size_t) (end - ip) < lit_cnt || (size_t) (op_end - op) < lit_cnt)
+        return LZ_ERROR;
+      memcpy (op, ip, lit_cnt);
+      ip += lit_cnt;
+      op += lit_cnt;
+      if (ip == end)
+        break;
+
+      /* Match.  It may overlap its own output, so copy it a byte
+         at a time. */
+      if (end - ip < 2)
+        return LZ_ERROR;
+      offset = ip[0] | ip[1] << 8;
+      ip += 2;
+      if (match_len == 15 && !get_length (&ip, end, &match_len))
+        return LZ_ERROR;
+      match_len += MIN_MATCH;
+      if (offset == 0 || offset > (size_t) (op - dst)
+          || (size_t) (op_end - op) < match_len)
+        return LZ_ERROR;
+      for (; match_len > 0; match_len--, op++)
+        *op = op[-offset];
+    }
+  return op - dst;
+}
+
+/* Adds the extra length bytes at *IP, which ends at END, to *LEN
+   and advances *IP past them.  Returns false if they run past
+   END. */
+static bool
+get_length (const uint8_t **ip, const uint8_t *end, size_t *len)
+{
+  unsigned b;
+
+  do
+    {
+      if (*ip >= end)
+        return false;
+      b = *(*ip)++;
+      *len += b;
+    }
+  while (b == 255);
+  return true;
+}
@@ -0,0 +1,22 @@
+#ifndef __LIB_KERNEL_LZ_H
+#define __LIB_KERNEL_LZ_H
+
+#include <stddef.h>
+
+/* Fast LZ77-class compression, in the spirit of LZ4: no entropy
+   coding, just literal runs and back-references, so that both
+   directions run at close to memory speed.  Blocks are limited
+   to 64 kB. */
+
+/* Bytes of scratch memory that lz_compress() needs. */
+#define LZ_WORK_SIZE 4096
+
+/* Returned by lz_decompress() for malformed input. */
+#define LZ_ERROR ((size_t) -1)
+
+size_t lz_compress (const void *src, size_t size, void *dst, size_t dst_size,
+                    void *work);
+size_t lz_decompress (const void *src, size_t size,
+                      void *dst, size_t dst_size);
+
+#endif /* lib/kernel/lz.h */
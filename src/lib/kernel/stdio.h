@@ -1,6 +1,9 @@
 #ifndef __LIB_KERNEL_STDIO_H
 #define __LIB_KERNEL_STDIO_H
 
+struct iovec;
+
 void putbuf (const char *, size_t);
+void putbufv (const struct iovec *, int cnt);
 
 #endif /* lib/kernel/stdio.h */
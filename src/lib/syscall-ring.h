@@ -0,0 +1,50 @@
+#ifndef __LIB_SYSCALL_RING_H
+#define __LIB_SYSCALL_RING_H
+
+/* System call rings.
+
+   A process that makes many small file system calls can queue
+   them in a ring in its own memory and have the kernel carry out
+   the whole batch in a single ring_enter() system call, instead
+   of trapping into the kernel once per call.
+
+   The process adds entries at sq_tail and the kernel consumes
+   them from sq_head.  For each one, the kernel posts a result at
+   cq_tail, and the process consumes results from cq_head.  The
+   head and tail counters run freely and wrap around; an entry's
+   slot is its counter modulo RING_ENTRIES.  Each side writes
+   only its own counters.
+
+   Only calls that work on files may be queued.  Others complete
+   with result -1. */
+
+/* Number of entries in each ring.  Must be a power of 2. */
+#define RING_ENTRIES 64
+
+/* A queued system call. */
+struct ring_sqe
+  {
+    int call_nr;                /* System call number, a SYS_* value. */
+    int args[3];                /* Arguments, as on the stack. */
+    int user_data;              /* Copied to the result. */
+  };
+
+/* The result of a queued system call. */
+struct ring_cqe
+  {
+    int user_data;              /* From the submission. */
+    int result;                 /* System call return value. */
+  };
+
+/* A submission ring and its completion ring. */
+struct ring
+  {
+    unsigned sq_head;           /* Next submission for the kernel. */
+    unsigned sq_tail;           /* Next free submission slot. */
+    unsigned cq_head;           /* Next completion for the process. */
+    unsigned cq_tail;           /* Next free completion slot. */
+    struct ring_sqe sq[RING_ENTRIES];   /* Submissions. */
+    struct ring_cqe cq[RING_ENTRIES];   /* Completions. */
+  };
+
+#endif /* lib/syscall-ring.h */
@@ -1,10 +1,12 @@
 #include <syscall.h>
 
 int main (int, char *[]);
+void syscall_probe (void);
 void _start (int argc, char *argv[]);
 
 void
 _start (int argc, char *argv[]) 
 {
+  syscall_probe ();
   exit (main (argc, argv));
 }
@@ -0,0 +1,93 @@
+#include <ring.h>
+#include <syscall.h>
+#include <syscall-nr.h>
+
+/* Initializes R as an empty ring. */
+void
+ring_init (struct ring *r)
+{
+  r->sq_head = r->sq_tail = 0;
+  r->cq_head = r->cq_tail = 0;
+}
+
+/* Queues system call CALL_NR with the given arguments in R, to
+   be carried out by the next ring_submit().  Its result will
+   carry USER_DATA.  Returns true if successful, false if R's
+   submission ring is full. */
+bool
+ring_queue (struct ring *r, int call_nr, int arg0, int arg1, int arg2,
+            int user_data)
+{
+  struct ring_sqe *sqe;
+
+  if (r->sq_tail - r->sq_head >= RING_ENTRIES)
+    return false;
+
+  sqe = &r->sq[r->sq_tail % RING_ENTRIES];
+  sqe->call_nr = call_nr;
+  sqe->args[0] = arg0;
+  sqe->args[1] = arg1;
+  sqe->args[2] = arg2;
+  sqe->user_data = user_data;
+  r->sq_tail++;
+  return true;
+}
+
+/* Has the kernel carry out the system calls queued in R, as
+   many as there is room to hold results for, with a single
+   system call.  Returns the number carried out. */
+int
+ring_submit (struct ring *r)
+{
+  return ring_enter (r);
+}
+
+/* Removes the oldest result from R and stores it in *CQE.
+   Returns true if successful, false if R has no results. */
+bool
+ring_complete (struct ring *r, struct ring_cqe *cqe)
+{
+  if (r->cq_head == r->cq_tail)
+    return false;
+
+  *cqe = r->cq[r->cq_head % RING_ENTRIES];
+  r->cq_head++;
+  return true;
+}
+
+/* Queues open(FILE) in R. */
+bool
+ring_open (struct ring *r, const char *file, int user_data)
+{
+  return ring_queue (r, SYS_OPEN, (int) file, 0, 0, user_data);
+}
+
+/* Queues close(FD) in R. */
+bool
+ring_close (struct ring *r, int fd, int user_data)
+{
+  return ring_queue (r, SYS_CLOSE, fd, 0, 0, user_data);
+}
+
+/* Queues read(FD, BUFFER, LENGTH) in R. */
+bool
+ring_read (struct ring *r, int fd, void *buffer, unsigned length,
+           int user_data)
+{
+  return ring_queue (r, SYS_READ, fd, (int) buffer, length, user_data);
+}
+
+/* Queues write(FD, BUFFER, LENGTH) in R. */
+bool
+ring_write (struct ring *r, int fd, const void *buffer, unsigned length,
+            int user_data)
+{
+  return ring_queue (r, SYS_WRITE, fd, (int) buffer, length, user_data);
+}
+
+/* Queues seek(FD, POSITION) in R. */
+bool
+ring_seek (struct ring *r, int fd, unsigned position, int user_data)
+{
+  return ring_queue (r, SYS_SEEK, fd, position, 0, user_data);
+}
@@ -0,0 +1,24 @@
+#ifndef __LIB_USER_RING_H
+#define __LIB_USER_RING_H
+
+#include <stdbool.h>
+#include <syscall-ring.h>
+
+/* Queuing system calls in a system call ring.  See
+   lib/syscall-ring.h. */
+
+void ring_init (struct ring *);
+bool ring_queue (struct ring *, int call_nr, int arg0, int arg1, int arg2,
+                 int user_data);
+int ring_submit (struct ring *);
+bool ring_complete (struct ring *, struct ring_cqe *);
+
+bool ring_open (struct ring *, const char *file, int user_data);
+bool ring_close (struct ring *, int fd, int user_data);
+bool ring_read (struct ring *, int fd, void *buffer, unsigned length,
+                int user_data);
+bool ring_write (struct ring *, int fd, const void *buffer, unsigned length,
+                 int user_data);
+bool ring_seek (struct ring *, int fd, unsigned position, int user_data);
+
+#endif /* lib/user/ring.h */
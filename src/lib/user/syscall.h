@@ -8,6 +8,10 @@
 typedef int pid_t;
 #define PID_ERROR ((pid_t) -1)
 
+/* Thread identifier. */
+typedef int tid_t;
+#define TID_ERROR ((tid_t) -1)
+
 /* Map region identifier. */
 typedef int mapid_t;
 #define MAP_FAILED ((mapid_t) -1)
@@ -45,4 +49,22 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+struct ring;
+struct iovec;
+pid_t fork (void);
+int ring_enter (struct ring *);
+int readv (int fd, const struct iovec *, int iovcnt);
+int writev (int fd, const struct iovec *, int iovcnt);
+int pread (int fd, void *buffer, unsigned length, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned length, unsigned offset);
+int copyfile (int src_fd, int dst_fd, unsigned offset, unsigned length);
+int pipe (int fds[2]);
+int dup (int fd);
+int dup2 (int old_fd, int new_fd);
+int fcntl (int fd, int cmd, int arg);
+tid_t thread_create (int (*func) (void *), void *aux);
+int thread_join (tid_t);
+void thread_exit (int status) NO_RETURN;
+
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,63 @@
+#include <vtime.h>
+#include <vdso.h>
+
+/* Optimization barrier.  See threads/synch.h. */
+#define barrier() asm volatile ("" : : : "memory")
+
+static void vtime_read (struct vdso_data *);
+
+/* Returns the number of timer ticks since the OS booted. */
+int64_t
+vtime_ticks (void)
+{
+  struct vdso_data d;
+  vtime_read (&d);
+  return d.ticks;
+}
+
+/* Returns the number of timer ticks per second. */
+int
+vtime_timer_freq (void)
+{
+  const volatile struct vdso_data *vdso = VDSO_BASE;
+  return vdso->timer_freq;
+}
+
+/* Returns the number of timer ticks during which this process
+   has run. */
+int64_t
+vtime_cpu_ticks (void)
+{
+  struct vdso_data d;
+  vtime_read (&d);
+  return d.cpu_ticks;
+}
+
+/* Returns 100 times the system load average. */
+int
+vtime_load_avg (void)
+{
+  struct vdso_data d;
+  vtime_read (&d);
+  return d.load_avg;
+}
+
+/* Copies a consistent snapshot of the vDSO page into D, reading
+   again if the kernel changed the page in the middle. */
+static void
+vtime_read (struct vdso_data *d)
+{
+  const volatile struct vdso_data *vdso = VDSO_BASE;
+  unsigned seq;
+
+  do
+    {
+      seq = vdso->seq;
+      barrier ();
+      d->ticks = vdso->ticks;
+      d->cpu_ticks = vdso->cpu_ticks;
+      d->load_avg = vdso->load_avg;
+      barrier ();
+    }
+  while ((seq & 1) != 0 || seq != vdso->seq);
+}
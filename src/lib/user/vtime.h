@@ -0,0 +1,14 @@
+#ifndef __LIB_USER_VTIME_H
+#define __LIB_USER_VTIME_H
+
+#include <stdint.h>
+
+/* Reading the time and statistics from the vDSO page, without a
+   system call.  See lib/vdso.h. */
+
+int64_t vtime_ticks (void);
+int vtime_timer_freq (void);
+int64_t vtime_cpu_ticks (void);
+int vtime_load_avg (void);
+
+#endif /* lib/user/vtime.h */
@@ -0,0 +1,33 @@
+#ifndef __LIB_VDSO_H
+#define __LIB_VDSO_H
+
+#include <stdint.h>
+
+/* The vDSO page.
+
+   The kernel maps one read-only page into every user process at
+   VDSO_BASE, holding the time and a few statistics, so that a
+   process can read them without a system call.  The page belongs
+   to the process, so it also holds per-process counters.  The
+   kernel refreshes it at each timer tick while the process runs
+   and whenever the process is scheduled, so it is never stale
+   when the process looks at it.
+
+   The kernel makes `seq' odd before it changes the page and even
+   again afterward.  A reader must check that `seq' was even and
+   unchanged across its reads, and read again otherwise. */
+
+/* User virtual address of the vDSO page. */
+#define VDSO_BASE ((void *) 0x08000000)
+
+/* Contents of the vDSO page. */
+struct vdso_data
+  {
+    unsigned seq;               /* Sequence count, odd while changing. */
+    int timer_freq;             /* Timer ticks per second. */
+    int64_t ticks;              /* Timer ticks since boot. */
+    int64_t cpu_ticks;          /* Timer ticks this process has run. */
+    int load_avg;               /* 100 times the system load average. */
+  };
+
+#endif /* lib/vdso.h */
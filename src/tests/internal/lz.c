@@ -0,0 +1,108 @@
+/* Test program for lib/kernel/lz.c.
+
+   Compresses and decompresses blocks of random, repetitive, and
+   all-zero data of various sizes, checks that each comes back
+   unchanged, and checks that a too-small output buffer and
+   garbage input are rejected rather than overrun.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <lz.h>
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/test.h"
+
+/* Largest block that we check, in bytes. */
+#define MAX_SIZE 4096
+
+/* Kinds of test data. */
+enum fill
+  {
+    FILL_RANDOM,                /* Random bytes. */
+    FILL_ZERO,                  /* All zeros. */
+    FILL_SMALL,                 /* Random bytes from a 4-byte alphabet. */
+    FILL_PATTERN,               /* A repeating pattern, lightly damaged. */
+    FILL_CNT
+  };
+
+static void fill (unsigned char *, size_t, enum fill);
+
+/* Test LZ compression. */
+void
+test (void)
+{
+  static unsigned char src[MAX_SIZE], lz[MAX_SIZE * 2], out[MAX_SIZE];
+  static unsigned char work[LZ_WORK_SIZE];
+  size_t size;
+  int i;
+
+  printf ("testing various size blocks:");
+  for (size = 0; size <= MAX_SIZE; size = size * 5 / 4 + 1)
+    {
+      enum fill f;
+
+      printf (" %zu", size);
+      for (f = 0; f < FILL_CNT; f++)
+        {
+          size_t lz_size;
+
+          fill (src, size, f);
+          lz_size = lz_compress (src, size, lz, sizeof lz, work);
+          ASSERT (lz_size > 0);
+          ASSERT (lz_decompress (lz, lz_size, out, sizeof out) == size);
+          ASSERT (!memcmp (src, out, size));
+
+          /* Every byte of output space is needed. */
+          ASSERT (lz_compress (src, size, lz, lz_size - 1, work) == 0);
+          ASSERT (lz_decompress (lz, lz_size, out, size / 2) == LZ_ERROR
+                  || size == 0);
+        }
+    }
+  printf (" done\n");
+
+  /* Garbage must not make the decompressor overrun its output. */
+  for (i = 0; i < 10000; i++)
+    {
+      size_t garbage_size = random_ulong () % 64;
+      random_bytes (lz, garbage_size);
+      lz_decompress (lz, garbage_size, out, 128);
+    }
+
+  printf ("lz: PASS\n");
+}
+
+/* Fills the SIZE bytes at P with data of kind F. */
+static void
+fill (unsigned char *p, size_t size, enum fill f)
+{
+  size_t i;
+
+  switch (f)
+    {
+    case FILL_RANDOM:
+      random_bytes (p, size);
+      break;
+
+    case FILL_ZERO:
+      memset (p, 0, size);
+      break;
+
+    case FILL_SMALL:
+      for (i = 0; i < size; i++)
+        p[i] = random_ulong () % 4;
+      break;
+
+    case FILL_PATTERN:
+      for (i = 0; i < size; i++)
+        p[i] = i % 37 + (random_ulong () % 50 == 0);
+      break;
+
+    default:
+      NOT_REACHED ();
+    }
+}
@@ -0,0 +1,166 @@
+/* Test program for the block functions in lib/string.c.
+
+   Checks memcpy(), memmove(), memset(), and memcmp() against
+   simple bytewise reference versions for every combination of
+   source and destination alignment over a range of sizes, then
+   times page-sized copies and clears against the reference
+   versions.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/test.h"
+#include "devices/timer.h"
+#include "threads/vaddr.h"
+
+/* Largest block that we check, in bytes. */
+#define MAX_SIZE 300
+
+/* Number of page-sized operations per timing run. */
+#define BENCH_CNT 4096
+
+static void ref_copy (unsigned char *, const unsigned char *, size_t);
+static void ref_move (unsigned char *, const unsigned char *, size_t);
+static void ref_set (unsigned char *, int, size_t);
+static int ref_cmp (const unsigned char *, const unsigned char *, size_t);
+static int sign (int);
+static void bench (void);
+
+/* Test block function implementations. */
+void
+test (void)
+{
+  static unsigned char src[MAX_SIZE + 8], got[MAX_SIZE + 64],
+    want[MAX_SIZE + 64];
+  size_t size;
+  int s_ofs, d_ofs;
+
+  printf ("testing various size blocks:");
+  for (size = 0; size <= MAX_SIZE; size = size * 5 / 4 + 1)
+    {
+      printf (" %zu", size);
+      for (s_ofs = 0; s_ofs < 4; s_ofs++)
+        for (d_ofs = 0; d_ofs < 4; d_ofs++)
+          {
+            int value = random_ulong ();
+            int delta;
+
+            /* memcpy(). */
+            random_bytes (src, sizeof src);
+            random_bytes (got, sizeof got);
+            memcpy (want, got, sizeof want);
+            ASSERT (memcpy (got + d_ofs, src + s_ofs, size) == got + d_ofs);
+            ref_copy (want + d_ofs, src + s_ofs, size);
+            ASSERT (!memcmp (got, want, sizeof got));
+
+            /* memset(). */
+            ASSERT (memset (got + d_ofs, value, size) == got + d_ofs);
+            ref_set (want + d_ofs, value, size);
+            ASSERT (!memcmp (got, want, sizeof got));
+
+            /* memmove() with every overlap from -20 to +20 bytes. */
+            for (delta = -20; delta <= 20; delta++)
+              {
+                unsigned char *from = got + 24 + s_ofs;
+                ASSERT (memmove (from + delta, from, size) == from + delta);
+                ref_move (want + 24 + s_ofs + delta, want + 24 + s_ofs, size);
+                ASSERT (!memcmp (got, want, sizeof got));
+              }
+
+            /* memcmp(), equal and with a single bit changed. */
+            memcpy (got + d_ofs, src + s_ofs, size);
+            ASSERT (memcmp (got + d_ofs, src + s_ofs, size) == 0);
+            if (size > 0)
+              {
+                size_t i = random_ulong () % size;
+                got[d_ofs + i] ^= 1 << random_ulong () % 8;
+                ASSERT (sign (memcmp (got + d_ofs, src + s_ofs, size))
+                        == sign (ref_cmp (got + d_ofs, src + s_ofs, size)));
+              }
+          }
+    }
+  printf (" done\n");
+
+  bench ();
+  printf ("string: PASS\n");
+}
+
+/* Times BENCH_CNT page-sized copies, clears, and compares, using
+   both lib/string.c and the bytewise reference versions, and
+   prints the timer ticks each took. */
+static void
+bench (void)
+{
+  static unsigned char a[PGSIZE], b[PGSIZE];
+  int64_t start;
+  int i;
+
+#define TIME(NAME, STMT)                                        \
+  start = timer_ticks ();                                       \
+  for (i = 0; i < BENCH_CNT; i++)                               \
+    STMT;                                                       \
+  printf ("%-10s %5"PRId64" ticks\n", NAME, timer_elapsed (start));
+
+  TIME ("memcpy", memcpy (a, b, PGSIZE));
+  TIME ("ref_copy", ref_copy (a, b, PGSIZE));
+  TIME ("memset", memset (a, i, PGSIZE));
+  TIME ("ref_set", ref_set (a, i, PGSIZE));
+  TIME ("memmove", memmove (a + 1, a, PGSIZE - 1));
+  TIME ("ref_move", ref_move (a + 1, a, PGSIZE - 1));
+  memcpy (b, a, PGSIZE);
+  TIME ("memcmp", ASSERT (memcmp (a, b, PGSIZE) == 0));
+  TIME ("ref_cmp", ASSERT (ref_cmp (a, b, PGSIZE) == 0));
+
+#undef TIME
+}
+
+/* Reference memcpy(). */
+static void
+ref_copy (unsigned char *dst, const unsigned char *src, size_t size)
+{
+  while (size-- > 0)
+    *dst++ = *src++;
+}
+
+/* Reference memmove(). */
+static void
+ref_move (unsigned char *dst, const unsigned char *src, size_t size)
+{
+  if (dst < src)
+    ref_copy (dst, src, size);
+  else
+    while (size-- > 0)
+      dst[size] = src[size];
+}
+
+/* Reference memset(). */
+static void
+ref_set (unsigned char *dst, int value, size_t size)
+{
+  while (size-- > 0)
+    *dst++ = value;
+}
+
+/* Reference memcmp(). */
+static int
+ref_cmp (const unsigned char *a, const unsigned char *b, size_t size)
+{
+  for (; size-- > 0; a++, b++)
+    if (*a != *b)
+      return *a > *b ? +1 : -1;
+  return 0;
+}
+
+/* Returns the sign of X: -1, 0, or +1. */
+static int
+sign (int x)
+{
+  return (x > 0) - (x < 0);
+}
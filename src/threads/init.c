@@ -37,6 +37,12 @@
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
+#ifdef VM
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/swap.h"
+#include "vm/zswap.h"
+#endif
 
 /* Page directory with kernel mappings only. */
 uint32_t *init_page_dir;
@@ -91,13 +97,16 @@ main (void)
   console_init ();  
 
   /* Greet user. */
-  printf ("Pintos booting with %'"PRIu32" kB RAM...\n",
-          init_ram_pages * PGSIZE / 1024);
+  klog (KLOG_INFO, "Pintos booting with %'"PRIu32" kB RAM...",
+        init_ram_pages * PGSIZE / 1024);
 
   /* Initialize memory system. */
   palloc_init (user_page_limit);
   malloc_init ();
   paging_init ();
+#ifdef VM
+  frame_init ();
+#endif
 
   /* Segmentation. */
 #ifdef USERPROG
@@ -113,11 +122,13 @@ main (void)
 #ifdef USERPROG
   exception_init ();
   syscall_init ();
+  process_init ();
 #endif
 
   /* Start thread scheduler and enable interrupts. */
   thread_start ();
   serial_init_queue ();
+  console_init_drain ();
   timer_calibrate ();
 
 #ifdef FILESYS
@@ -126,8 +137,12 @@ main (void)
   locate_block_devices ();
   filesys_init (format_filesys);
 #endif
+#ifdef VM
+  swap_init ();
+  frame_init_pageout ();
+#endif
 
-  printf ("Boot complete.\n");
+  klog (KLOG_INFO, "Boot complete.");
   
   /* Run actions specified on kernel command line. */
   run_actions (argv);
@@ -247,11 +262,27 @@ parse_options (char **argv)
         filesys_bdev_name = value;
       else if (!strcmp (name, "-scratch"))
         scratch_bdev_name = value;
+      else if (!strcmp (name, "-ide-large"))
+        ide_large_disks = true;
 #ifdef VM
       else if (!strcmp (name, "-swap"))
         swap_bdev_name = value;
 #endif
 #endif
+      else if (!strcmp (name, "-baud"))
+        {
+          int bps = value != NULL ? atoi (value) : 0;
+          if (bps < 300 || bps > 115200 || 115200 % bps != 0)
+            PANIC ("bad serial speed `%s' (use -h for help)", value);
+          serial_set_speed (bps);
+        }
+      else if (!strcmp (name, "-loglevel"))
+        {
+          int level = value != NULL ? atoi (value) : -1;
+          if (level < KLOG_ERR || level > KLOG_DEBUG)
+            PANIC ("bad log level `%s' (use -h for help)", value);
+          klog_console_level = level;
+        }
       else if (!strcmp (name, "-rs"))
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
@@ -259,6 +290,17 @@ parse_options (char **argv)
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+#endif
+#ifdef VM
+      else if (!strcmp (name, "-zswap"))
+        zswap_pages = atoi (value);
+      else if (!strcmp (name, "-stack"))
+        {
+          int pages = value != NULL ? atoi (value) : 0;
+          if (pages < 1)
+            PANIC ("bad stack limit `%s' (use -h for help)", value);
+          stack_max_pages = pages;
+        }
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
@@ -315,6 +357,7 @@ run_actions (char **argv)
       {"rm", 2, fsutil_rm},
       {"extract", 1, fsutil_extract},
       {"append", 2, fsutil_append},
+      {"dumplog", 1, fsutil_dumplog},
 #endif
       {NULL, 0, NULL},
     };
@@ -364,6 +407,7 @@ usage (void)
           "Use these actions indirectly via `pintos' -g and -p options:\n"
           "  extract            Untar from scratch device into file system.\n"
           "  append FILE        Append FILE to tar file on scratch device.\n"
+          "  dumplog            Append kernel log to tar file on scratch device.\n"
 #endif
           "\nOptions:\n"
           "  -h                 Print this help message and power off.\n"
@@ -373,14 +417,21 @@ usage (void)
           "  -f                 Format file system device during startup.\n"
           "  -filesys=BDEV      Use BDEV for file system instead of default.\n"
           "  -scratch=BDEV      Use BDEV for scratch instead of default.\n"
+          "  -ide-large         Allow IDE disks of 1 GB and larger.\n"
 #ifdef VM
           "  -swap=BDEV         Use BDEV for swap instead of default.\n"
 #endif
 #endif
+          "  -baud=BPS          Run the serial port at BPS (default 9600).\n"
+          "  -loglevel=N        Display kernel log records up to level N (0-3).\n"
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+          "  -zswap=PAGES       Compress swap into PAGES pages (default 128).\n"
+          "  -stack=PAGES       Limit user stacks to PAGES pages (default 2048).\n"
 #endif
           );
   shutdown_power_off ();
@@ -422,7 +473,8 @@ locate_block_device (enum block_type role, const char *name)
 
   if (block != NULL)
     {
-      printf ("%s: using %s\n", block_type_name (role), block_name (block));
+      klog (KLOG_INFO, "%s: using %s",
+            block_type_name (role), block_name (block));
       block_set_role (role, block);
     }
 }
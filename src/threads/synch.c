@@ -76,6 +76,38 @@ sema_down (struct semaphore *sema)
   intr_set_level (old_level);
 }
 
+/* Like sema_down(), but gives up if thread_interrupt() is called
+   on the current thread before or while it waits.  Returns true
+   if SEMA was decremented, false if the wait was interrupted. */
+bool
+sema_down_interruptible (struct semaphore *sema)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  bool success = true;
+
+  ASSERT (sema != NULL);
+  ASSERT (!intr_context ());
+
+  old_level = intr_disable ();
+  while (sema->value == 0)
+    {
+      if (cur->interrupted)
+        {
+          success = false;
+          break;
+        }
+      list_insert_ordered (&sema->waiters, &cur->elem, thread_cmp_priority, NULL);
+      cur->intr_sema = sema;
+      thread_block ();
+      cur->intr_sema = NULL;
+    }
+  if (success)
+    sema->value--;
+  intr_set_level (old_level);
+  return success;
+}
+
 /* Down or "P" operation on a semaphore, but only if the
    semaphore is not already 0.  Returns true if the semaphore is
    decremented, false otherwise.
@@ -270,8 +302,15 @@ sema_cmp_priority(const struct list_elem *a, const struct list_elem *b, void *au
   struct semaphore_elem *sem1 = list_entry(a, struct semaphore_elem, elem);
   struct semaphore_elem *sem2 = list_entry(b, struct semaphore_elem, elem);
 
-  struct thread *t1 = list_entry(list_front(&sem1->semaphore.waiters), struct thread, elem);
-  struct thread *t2 = list_entry(list_front(&sem2->semaphore.waiters), struct thread, elem);
+  struct thread *t1, *t2;
+
+  /* An interrupted waiter has already left its semaphore. */
+  if (list_empty (&sem2->semaphore.waiters))
+    return false;
+  if (list_empty (&sem1->semaphore.waiters))
+    return true;
+  t1 = list_entry(list_front(&sem1->semaphore.waiters), struct thread, elem);
+  t2 = list_entry(list_front(&sem2->semaphore.waiters), struct thread, elem);
   return t1->priority < t2->priority;
 }
 
@@ -325,6 +364,41 @@ cond_wait (struct condition *cond, struct lock *lock)
 }
 
 
+/* Like cond_wait(), but gives up if thread_interrupt() is called
+   on the current thread before or while it waits.  LOCK is
+   reacquired either way.  Returns true if COND was signaled,
+   false if the wait was interrupted. */
+bool
+cond_wait_interruptible (struct condition *cond, struct lock *lock)
+{
+  struct semaphore_elem waiter;
+  bool success;
+
+  ASSERT (cond != NULL);
+  ASSERT (lock != NULL);
+  ASSERT (!intr_context ());
+  ASSERT (lock_held_by_current_thread (lock));
+
+  sema_init (&waiter.semaphore, 0);
+  list_push_back (&cond->waiters, &waiter.elem);
+
+  lock_release (lock);
+  success = sema_down_interruptible (&waiter.semaphore);
+  lock_acquire (lock);
+
+  /* Signals are sent with LOCK held, so now either we were
+     signaled, and taken off COND's list, or we are still on it.
+     Pass a signal that came too late on to another waiter. */
+  if (!success)
+    {
+      if (waiter.semaphore.value > 0)
+        cond_signal (cond, lock);
+      else
+        list_remove (&waiter.elem);
+    }
+  return success;
+}
+
 /* If any threads are waiting on COND (protected by LOCK), then
    this function signals one of them to wake up from its wait.
    LOCK must be held before calling this function.
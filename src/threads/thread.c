@@ -15,6 +15,7 @@
 #include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
+#include "userprog/vdso.h"
 #endif
 
 
@@ -279,6 +280,10 @@ thread_tick (void)
   else
     kernel_ticks++;
 
+#ifdef USERPROG
+  vdso_update (true);
+#endif
+
   /* Enforce preemption. */
   if (++thread_ticks >= TIME_SLICE)
     intr_yield_on_return ();
@@ -402,6 +407,27 @@ thread_unblock (struct thread *t)
   intr_set_level (old_level);
 }
 
+/* Makes T's interruptible waits fail, the one it is blocked in,
+   if any, and all later ones, as when T's process is killed.
+   See sema_down_interruptible(). */
+void
+thread_interrupt (struct thread *t)
+{
+  enum intr_level old_level;
+
+  ASSERT (is_thread (t));
+
+  old_level = intr_disable ();
+  t->interrupted = true;
+  if (t->status == THREAD_BLOCKED && t->intr_sema != NULL)
+    {
+      list_remove (&t->elem);
+      t->intr_sema = NULL;
+      thread_unblock (t);
+    }
+  intr_set_level (old_level);
+}
+
 /* Returns the name of the running thread. */
 const char *
 thread_name (void) 
@@ -655,6 +681,19 @@ init_thread (struct thread *t, const char *name, int priority)
   strlcpy (t->name, name, sizeof t->name);
   t->stack = (uint8_t *) t + PGSIZE;
   t->magic = THREAD_MAGIC;
+#ifdef USERPROG
+  t->leader = t;
+  t->exit_code = -1;
+  list_init (&t->children);
+  list_init (&t->threads);
+  t->next_handle = 2;
+#endif
+#ifdef VM
+  t->user_stack = PHYS_BASE;
+  t->stack_slots = 1;
+  list_init (&t->mappings);
+  lock_init (&t->mappings_lock);
+#endif
   struct thread *current = running_thread();
   if (!thread_mlfqs) {
     t->priority = priority;
@@ -4,6 +4,7 @@
 #include <debug.h>
 #include <list.h>
 #include <stdint.h>
+#include "threads/synch.h"
 
 /* States in a thread's life cycle. */
 enum thread_status
@@ -92,13 +93,41 @@ struct thread
 
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
+    struct semaphore *intr_sema;        /* Semaphore in interruptible wait. */
+    bool interrupted;                   /* Interruptible waits fail. */
 
     int nice;
     int recent_cpu;
 
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
+    struct thread *leader;              /* First thread of the process. */
     uint32_t *pagedir;                  /* Page directory. */
+    int exit_code;                      /* Exit code. */
+    bool exiting;                       /* Process is exiting (leader). */
+    struct exit_record *exit_record;    /* Reported to parent on exit. */
+    struct list children;               /* Exit records of children. */
+    struct list threads;                /* Exit records of other threads. */
+    struct vdso_data *vdso;             /* vDSO page, if any. */
+
+    /* Owned by userprog/syscall.c. */
+    struct fd_table *fd_table;          /* File descriptors. */
+    int next_handle;                    /* Next mapping id. */
+#endif
+
+#ifdef VM
+    /* Owned by vm/page.c. */
+    struct page_table *pages;           /* Supplemental page table. */
+    struct file *bin_file;              /* Executable, for demand paging. */
+    uint8_t *ra_next;                   /* Fault that continues a run. */
+    int ra_window;                      /* Pages brought in per fault. */
+    void *user_esp;                     /* User %esp on kernel entry. */
+    void *user_stack;                   /* Top of this thread's stack. */
+    uint32_t stack_slots;               /* Stacks in use (leader). */
+
+    /* Owned by userprog/syscall.c. */
+    struct list mappings;               /* Memory-mapped files. */
+    struct lock mappings_lock;          /* Protects mappings. */
 #endif
 
     /* Owned by thread.c. */
@@ -122,6 +151,7 @@ tid_t thread_create (const char *name, int priority, thread_func *, void *);
 
 void thread_block (void);
 void thread_unblock (struct thread *);
+void thread_interrupt (struct thread *);
 
 struct thread *thread_current (void);
 tid_t thread_tid (void);
@@ -2,13 +2,21 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include "userprog/gdt.h"
+#include "userprog/process.h"
+#include "userprog/syscall.h"
+#include "userprog/uaccess.h"
+#include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
 
 static void kill (struct intr_frame *);
+static void debug (struct intr_frame *);
 static void page_fault (struct intr_frame *);
 
 /* Registers handlers for interrupts that can be caused by user
@@ -43,7 +51,7 @@ exception_init (void)
      caused indirectly, e.g. #DE can be caused by dividing by
      0.  */
   intr_register_int (0, 0, INTR_ON, kill, "#DE Divide Error");
-  intr_register_int (1, 0, INTR_ON, kill, "#DB Debug Exception");
+  intr_register_int (1, 0, INTR_ON, debug, "#DB Debug Exception");
   intr_register_int (6, 0, INTR_ON, kill, "#UD Invalid Opcode Exception");
   intr_register_int (7, 0, INTR_ON, kill,
                      "#NM Device Not Available Exception");
@@ -89,7 +97,8 @@ kill (struct intr_frame *f)
       printf ("%s: dying due to interrupt %#04x (%s).\n",
               thread_name (), f->vec_no, intr_name (f->vec_no));
       intr_dump_frame (f);
-      thread_exit (); 
+      process_kill (-1);
+      thread_exit ();
 
     case SEL_KCSEG:
       /* Kernel's code segment, which indicates a kernel bug.
@@ -104,10 +113,27 @@ kill (struct intr_frame *f)
          kernel. */
       printf ("Interrupt %#04x (%s) in unknown segment %04x\n",
              f->vec_no, intr_name (f->vec_no), f->cs);
+      process_kill (-1);
       thread_exit ();
     }
 }
 
+/* #DB handler.  SYSENTER leaves the trap flag alone, so a user
+   program that single-steps into a system call traps at the
+   start of sysenter_entry, in ring 0.  Clear the flag and let the
+   system call go on; the program is no longer single-stepped.
+   Any other #DB is handled like any other exception.  This runs
+   on the SYSENTER entry stack, where thread_current() does not
+   work. */
+static void
+debug (struct intr_frame *f)
+{
+  if (f->cs == SEL_KCSEG && syscall_in_sysenter_entry (f->eip))
+    f->eflags &= ~FLAG_TF;
+  else
+    kill (f);
+}
+
 /* Page fault handler.  This is a skeleton that must be filled in
    to implement virtual memory.  Some solutions to project 2 may
    also require modifying this code.
@@ -148,6 +174,25 @@ page_fault (struct intr_frame *f)
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
+#ifdef VM
+  /* Let the pager bring in pages that the process has mapped but
+     that are not yet in memory, and copy pages shared
+     copy-on-write with another process on the first write.  The
+     pager grows the stack based on the user stack pointer, which
+     is saved on entry to a system call for faults in the kernel. */
+  if (user)
+    thread_current ()->user_esp = f->esp;
+  if (not_present && page_in (fault_addr))
+    return;
+  else if (!not_present && write && page_write_fault (fault_addr))
+    return;
+#endif
+
+  /* A bad user address passed to the kernel makes the copy that
+     touched it fail. */
+  if (!user && uaccess_fixup (f))
+    return;
+
   /* To implement virtual memory, delete the rest of the function
      body, and replace it with code that brings in the page to
      which fault_addr refers. */
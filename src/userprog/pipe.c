@@ -0,0 +1,254 @@
+#include "userprog/pipe.h"
+#include <debug.h>
+#include <stdint.h>
+#include "userprog/process.h"
+#include "userprog/uaccess.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Pipes.
+
+   A pipe is a one-page ring buffer in the kernel with a read end
+   and a write end, each of which any number of file descriptors
+   may refer to.  Reading an empty pipe blocks until a writer
+   adds data or the last write end is closed, which reads as end
+   of file.  Writing a full pipe blocks until a reader makes room
+   or the last read end is closed, after which writes fail.
+   Either wait ends early if the waiting thread's process is
+   killed (see process_kill()).
+
+   Data moves directly between the ring buffer and user memory.
+   The copies may fault and page in user memory while holding the
+   pipe's lock, which is safe because no one holding filesys_lock
+   or a frame lock ever waits for a pipe. */
+
+/* Bytes of data a pipe can hold. */
+#define PIPE_SIZE PGSIZE
+
+/* A pipe. */
+struct pipe
+  {
+    struct lock lock;           /* Protects all the members. */
+    struct condition not_empty; /* Signaled when data or EOF arrives. */
+    struct condition not_full;  /* Signaled when room is made. */
+    int readers;                /* Number of open read ends. */
+    int writers;                /* Number of open write ends. */
+    uint8_t *buffer;            /* PIPE_SIZE bytes of data. */
+    size_t head;                /* Offset of first byte of data. */
+    size_t used;                /* Bytes of data in buffer. */
+  };
+
+/* Creates and returns a new, empty pipe with one read end and
+   one write end open, or a null pointer if memory is short. */
+struct pipe *
+pipe_create (void)
+{
+  struct pipe *p = malloc (sizeof *p);
+  if (p == NULL)
+    return NULL;
+
+  p->buffer = palloc_get_page (0);
+  if (p->buffer == NULL)
+    {
+      free (p);
+      return NULL;
+    }
+  lock_init (&p->lock);
+  cond_init (&p->not_empty);
+  cond_init (&p->not_full);
+  p->readers = p->writers = 1;
+  p->head = p->used = 0;
+  return p;
+}
+
+/* Opens another read end of P, or write end if WRITE is true. */
+void
+pipe_open (struct pipe *p, bool write)
+{
+  lock_acquire (&p->lock);
+  if (write)
+    p->writers++;
+  else
+    p->readers++;
+  lock_release (&p->lock);
+}
+
+/* Closes a read end of P, or a write end if WRITE is true, and
+   frees P when no ends of it remain open. */
+void
+pipe_close (struct pipe *p, bool write)
+{
+  bool destroy;
+
+  lock_acquire (&p->lock);
+  if (write)
+    {
+      ASSERT (p->writers > 0);
+      if (--p->writers == 0)
+        cond_broadcast (&p->not_empty, &p->lock);
+    }
+  else
+    {
+      ASSERT (p->readers > 0);
+      if (--p->readers == 0)
+        cond_broadcast (&p->not_full, &p->lock);
+    }
+  destroy = p->readers == 0 && p->writers == 0;
+  lock_release (&p->lock);
+
+  if (destroy)
+    {
+      palloc_free_page (p->buffer);
+      free (p);
+    }
+}
+
+/* Reads up to SIZE bytes from P into user buffer UDST, waiting
+   for data if P is empty.  Returns the number of bytes read,
+   which is 0 only at end of file or if the process is killed.
+   Kills the process if UDST is not a valid user buffer. */
+int
+pipe_read (struct pipe *p, void *udst, size_t size)
+{
+  struct iovec iov;
+
+  iov.iov_base = udst;
+  iov.iov_len = size;
+  return pipe_readv (p, &iov, 1);
+}
+
+/* Writes SIZE bytes from user buffer USRC into P, waiting for
+   room as necessary.  Returns the number of bytes written, which
+   is less than SIZE only if the last read end of P was closed or
+   the process is killed, or -1 if that happened before anything
+   was written.
+   Kills the process if USRC is not a valid user buffer. */
+int
+pipe_write (struct pipe *p, const void *usrc, size_t size)
+{
+  struct iovec iov;
+
+  iov.iov_base = (void *) usrc;
+  iov.iov_len = size;
+  return pipe_writev (p, &iov, 1);
+}
+
+/* Returns the total size of the IOVCNT buffers in IOV. */
+static size_t
+iov_size (const struct iovec *iov, int iovcnt)
+{
+  size_t size = 0;
+  int i;
+
+  for (i = 0; i < iovcnt; i++)
+    size += iov[i].iov_len;
+  return size;
+}
+
+/* Reads from P into the IOVCNT user buffers in IOV, filling
+   them in order, as pipe_read() does for a single buffer.  All
+   of the data read comes from P in a single critical section, so
+   that it is not interleaved with another reader's. */
+int
+pipe_readv (struct pipe *p, const struct iovec *iov, int iovcnt)
+{
+  size_t size = iov_size (iov, iovcnt);
+  size_t bytes_read = 0;
+  size_t iov_ofs = 0;
+  bool ok = true;
+
+  lock_acquire (&p->lock);
+  while (p->used == 0 && p->writers > 0 && size > 0)
+    if (!cond_wait_interruptible (&p->not_empty, &p->lock))
+      break;
+  while (bytes_read < size && p->used > 0)
+    {
+      size_t chunk = iov->iov_len - iov_ofs;
+      if (chunk > p->used)
+        chunk = p->used;
+      if (chunk > PIPE_SIZE - p->head)
+        chunk = PIPE_SIZE - p->head;
+
+      ok = copy_to_user ((uint8_t *) iov->iov_base + iov_ofs,
+                         p->buffer + p->head, chunk);
+      if (!ok)
+        break;
+      p->head = (p->head + chunk) % PIPE_SIZE;
+      p->used -= chunk;
+      bytes_read += chunk;
+      iov_ofs += chunk;
+      if (iov_ofs == iov->iov_len)
+        {
+          iov++;
+          iov_ofs = 0;
+        }
+    }
+  if (bytes_read > 0)
+    cond_broadcast (&p->not_full, &p->lock);
+  lock_release (&p->lock);
+
+  if (!ok)
+    {
+      process_kill (-1);
+      thread_exit ();
+    }
+  return bytes_read;
+}
+
+/* Writes the IOVCNT user buffers in IOV into P, in order, as
+   pipe_write() does for a single buffer.  The data goes into P in
+   a single critical section, except while waiting for room, so
+   that another writer's data cannot come between the buffers of
+   a vector that fits in P. */
+int
+pipe_writev (struct pipe *p, const struct iovec *iov, int iovcnt)
+{
+  size_t size = iov_size (iov, iovcnt);
+  size_t bytes_written = 0;
+  size_t iov_ofs = 0;
+  bool ok = true;
+
+  lock_acquire (&p->lock);
+  while (bytes_written < size)
+    {
+      size_t tail, chunk;
+
+      while (p->used == PIPE_SIZE && p->readers > 0)
+        if (!cond_wait_interruptible (&p->not_full, &p->lock))
+          break;
+      if (p->readers == 0 || p->used == PIPE_SIZE)
+        break;
+
+      tail = (p->head + p->used) % PIPE_SIZE;
+      chunk = iov->iov_len - iov_ofs;
+      if (chunk > PIPE_SIZE - p->used)
+        chunk = PIPE_SIZE - p->used;
+      if (chunk > PIPE_SIZE - tail)
+        chunk = PIPE_SIZE - tail;
+
+      ok = copy_from_user (p->buffer + tail,
+                           (const uint8_t *) iov->iov_base + iov_ofs, chunk);
+      if (!ok)
+        break;
+      p->used += chunk;
+      bytes_written += chunk;
+      iov_ofs += chunk;
+      if (iov_ofs == iov->iov_len)
+        {
+          iov++;
+          iov_ofs = 0;
+        }
+      cond_broadcast (&p->not_empty, &p->lock);
+    }
+  lock_release (&p->lock);
+
+  if (!ok)
+    {
+      process_kill (-1);
+      thread_exit ();
+    }
+  return bytes_written > 0 || size == 0 ? (int) bytes_written : -1;
+}
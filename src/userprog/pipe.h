@@ -0,0 +1,18 @@
+#ifndef USERPROG_PIPE_H
+#define USERPROG_PIPE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <uio.h>
+
+struct pipe;
+
+struct pipe *pipe_create (void);
+void pipe_open (struct pipe *, bool write);
+void pipe_close (struct pipe *, bool write);
+int pipe_read (struct pipe *, void *udst, size_t size);
+int pipe_write (struct pipe *, const void *usrc, size_t size);
+int pipe_readv (struct pipe *, const struct iovec *, int iovcnt);
+int pipe_writev (struct pipe *, const struct iovec *, int iovcnt);
+
+#endif /* userprog/pipe.h */
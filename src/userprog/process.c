@@ -1,33 +1,122 @@
 #include "userprog/process.h"
 #include <debug.h>
+#include <hash.h>
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <vdso.h>
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
+#include "userprog/syscall.h"
 #include "userprog/tss.h"
+#include "userprog/uaccess.h"
+#include "userprog/vdso.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 static thread_func start_process NO_RETURN;
-static bool load (const char *cmdline, void (**eip) (void), void **esp);
+#ifdef VM
+static thread_func fork_process NO_RETURN;
+static thread_func start_thread NO_RETURN;
+#endif
+static bool load (const char *cmd_line, void (**eip) (void), void **esp);
 
-/* Starts a new thread running a user program loaded from
-   FILENAME.  The new thread may be scheduled (and may even exit)
-   before process_execute() returns.  Returns the new process's
-   thread id, or TID_ERROR if the thread cannot be created. */
+/* The process table.
+
+   Each user process has an exit record, which holds its exit
+   code once it dies.  The record outlives the process itself, so
+   that its parent can still collect the exit code afterward, and
+   it is freed once both the parent and the child are done with
+   it: when the child has died and the parent has either waited
+   for it or died itself.
+
+   Exit records live in a hash table keyed by tid, so that
+   process_wait() finds a child's record in constant time no
+   matter how many children a process has started.  Each process
+   also keeps a list of its children's records, used only to
+   release them when it dies.
+
+   Each thread of a process other than its first, the leader,
+   has an exit record too, whose parent is the leader and which
+   lives on the leader's `threads' list instead, so that any
+   thread in the process can join it and the leader can wait for
+   all of them before the process goes away. */
+struct exit_record
+  {
+    struct hash_elem hash_elem; /* process_table element. */
+    struct list_elem elem;      /* Parent's `children' or `threads'. */
+    tid_t tid;                  /* Child's thread id. */
+    tid_t parent;               /* Parent's thread id. */
+    bool is_thread;             /* Thread of the parent's process? */
+    int ref_cnt;                /* 2=child and parent alive, 1=either, 0=neither. */
+    int exit_code;              /* Child's exit code, once dead. */
+    struct semaphore dead;      /* Upped when the child dies. */
+  };
+
+/* Exit records of all live processes and of dead processes whose
+   parents have not yet collected them, keyed by tid. */
+static struct hash process_table;
+
+/* Protects process_table, each exit record's ref_cnt, and each
+   process's `exiting' flag and `stack_slots'. */
+static struct lock process_table_lock;
+
+static hash_hash_func exit_record_hash;
+static hash_less_func exit_record_less;
+static bool exit_record_create (struct thread *leader, bool is_thread);
+static void exit_record_release (struct exit_record *);
+static int wait_for (tid_t, bool is_thread);
+static void wait_for_threads (void);
+static void report_exit (void);
+static thread_action_func interrupt_thread;
+#ifdef VM
+static int stack_slot (void *top);
+static uint8_t *alloc_stack_slot (void);
+static void free_stack_slot (struct thread *leader, void *top);
+#endif
+
+/* Initializes the process table. */
+void
+process_init (void)
+{
+  hash_init (&process_table, exit_record_hash, exit_record_less, NULL);
+  lock_init (&process_table_lock);
+}
+
+/* Passed from process_execute() to the child's start_process(). */
+struct exec_info
+  {
+    char *file_name;            /* Command line, in a page. */
+    struct thread *parent;      /* Process calling exec(). */
+    struct semaphore loaded;    /* Upped when the child is ready. */
+    bool success;               /* Whether the child loaded. */
+  };
+
+/* Starts a new thread running a user program loaded from the
+   first word of command line FILE_NAME; the whole command line
+   becomes the program's arguments.  The new process inherits the
+   current process's file descriptors.  Returns the new process's
+   thread id, or TID_ERROR if the thread cannot be created or the
+   program cannot be loaded. */
 tid_t
 process_execute (const char *file_name) 
 {
+  struct exec_info info;
+  char thread_name[16];
   char *fn_copy;
   tid_t tid;
 
@@ -37,20 +126,37 @@ process_execute (const char *file_name)
   if (fn_copy == NULL)
     return TID_ERROR;
   strlcpy (fn_copy, file_name, PGSIZE);
+  info.file_name = fn_copy;
+  info.parent = thread_current ();
+  sema_init (&info.loaded, 0);
+  info.success = false;
 
-  /* Create a new thread to execute FILE_NAME. */
-  tid = thread_create (file_name, PRI_DEFAULT, start_process, fn_copy);
+  /* Name the thread after the program, not the whole command
+     line. */
+  file_name += strspn (file_name, " ");
+  strlcpy (thread_name, file_name, sizeof thread_name);
+  thread_name[strcspn (thread_name, " ")] = '\0';
+
+  /* Create a new thread to execute FILE_NAME, and wait for it to
+     copy our file descriptors and load.  Waiting keeps the
+     descriptors steady while the child copies them. */
+  tid = thread_create (thread_name, PRI_DEFAULT, start_process, &info);
   if (tid == TID_ERROR)
-    palloc_free_page (fn_copy); 
-  return tid;
+    {
+      palloc_free_page (fn_copy);
+      return TID_ERROR;
+    }
+  sema_down (&info.loaded);
+  return info.success ? tid : TID_ERROR;
 }
 
 /* A thread function that loads a user process and starts it
    running. */
 static void
-start_process (void *file_name_)
+start_process (void *info_)
 {
-  char *file_name = file_name_;
+  struct exec_info *info = info_;
+  char *file_name = info->file_name;
   struct intr_frame if_;
   bool success;
 
@@ -59,10 +165,17 @@ start_process (void *file_name_)
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
-  success = load (file_name, &if_.eip, &if_.esp);
+  success = (syscall_inherit (info->parent, true)
+             && load (file_name, &if_.eip, &if_.esp)
+             && exit_record_create (info->parent->leader, false));
 
-  /* If load failed, quit. */
+  /* INFO is on the parent's stack, so it is gone once we up the
+     semaphore. */
   palloc_free_page (file_name);
+  info->success = success;
+  sema_up (&info->loaded);
+
+  /* If load failed, quit. */
   if (!success) 
     thread_exit ();
 
@@ -76,19 +189,521 @@ start_process (void *file_name_)
   NOT_REACHED ();
 }
 
+#ifdef VM
+/* Passed from process_fork() to the child's fork_process(). */
+struct fork_info
+  {
+    struct thread *parent;      /* Process being forked. */
+    struct intr_frame if_;      /* Parent's user context. */
+    struct semaphore done;      /* Upped when the child is ready. */
+    bool success;               /* Whether the copy succeeded. */
+  };
+
+/* Creates a child of the current process that is a copy of it,
+   resuming in user mode where the current system call returns,
+   with 0 in %eax.  The child's pages share the parent's frames
+   until either one writes them.  Only the calling thread is
+   copied, and it becomes the child's leader, keeping its stack
+   where it was.  Returns the child's thread id,
+   or TID_ERROR if the child could not be created. */
+tid_t
+process_fork (void)
+{
+  struct thread *cur = thread_current ();
+  struct fork_info info;
+  tid_t tid;
+
+  /* The user context that entered the kernel was pushed at the
+     top of this thread's kernel stack (see tss_update()). */
+  info.parent = cur;
+  info.if_ = ((struct intr_frame *) ((uint8_t *) cur + PGSIZE))[-1];
+  sema_init (&info.done, 0);
+  info.success = false;
+
+  /* The parent stays blocked until the child has finished
+     copying from it. */
+  tid = thread_create (cur->name, PRI_DEFAULT, fork_process, &info);
+  if (tid == TID_ERROR)
+    return TID_ERROR;
+  sema_down (&info.done);
+  return info.success ? tid : TID_ERROR;
+}
+
+/* A thread function that copies the address space and open
+   files of the process that called process_fork() and starts
+   running it. */
+static void
+fork_process (void *info_)
+{
+  struct fork_info *info = info_;
+  struct thread *parent = info->parent;
+  struct file *bin_file = parent->leader->bin_file;
+  struct thread *t = thread_current ();
+  struct intr_frame if_ = info->if_;
+  bool success = false;
+
+  t->user_stack = parent->user_stack;
+  t->stack_slots |= 1u << stack_slot (parent->user_stack);
+  t->pagedir = pagedir_create ();
+  if (t->pagedir == NULL)
+    goto done;
+  process_activate ();
+  if (!page_table_create () || !vdso_map ())
+    goto done;
+
+  /* Reopen the executable first, so that the child's pages can
+     be faulted in from its own handle. */
+  if (bin_file != NULL)
+    {
+      lock_acquire (&filesys_lock);
+      t->bin_file = file_reopen (bin_file);
+      if (t->bin_file != NULL)
+        file_deny_write (t->bin_file);
+      lock_release (&filesys_lock);
+      if (t->bin_file == NULL)
+        goto done;
+    }
+
+  success = (page_table_copy (parent)
+             && syscall_inherit (parent, false)
+             && exit_record_create (parent->leader, false));
+
+ done:
+  /* INFO is on the parent's stack, so it is gone once we up the
+     semaphore. */
+  info->success = success;
+  sema_up (&info->done);
+  if (!success)
+    thread_exit ();
+
+  /* Return to user mode as the parent did, but with fork()
+     returning 0. */
+  if_.eax = 0;
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+/* User threads.
+
+   Every process starts out with one thread, its leader.  Other
+   threads share the leader's page table, page directory, file
+   descriptors, vDSO page, and memory mappings, all of which
+   belong to the leader and are torn down only when it exits,
+   after it has waited for the others to go.
+
+   Each thread has a user stack of up to stack_max_pages pages in
+   a slot of its own: the leader's, slot 0, at the top of user
+   memory, and each other slot just below the one before, as
+   long as they stay above the vDSO page.  The leader's
+   `stack_slots' has a bit set for each slot in use. */
+
+/* Most threads in a process: one per bit in `stack_slots'. */
+#define MAX_THREADS 32
+
+/* Passed from process_thread_create() to the new thread's
+   start_thread(). */
+struct thread_info
+  {
+    struct thread *leader;      /* Leader of the process. */
+    void *entry;                /* User code to start at. */
+    void *args[2];              /* Arguments for ENTRY. */
+    uint8_t *stack;             /* Top of the new thread's stack. */
+    struct semaphore started;   /* Upped when the thread is ready. */
+    bool success;               /* Whether it started. */
+  };
+
+/* Starts a new thread in the current process, running in user
+   mode at ENTRY on a stack of its own, as if ENTRY had been
+   called with FUNC and AUX as its arguments.  Returns the new
+   thread's id, or TID_ERROR if it cannot be started. */
+tid_t
+process_thread_create (void *entry, void *func, void *aux)
+{
+  struct thread *cur = thread_current ();
+  struct thread_info info;
+  tid_t tid;
+
+  info.leader = cur->leader;
+  info.entry = entry;
+  info.args[0] = func;
+  info.args[1] = aux;
+  info.stack = alloc_stack_slot ();
+  if (info.stack == NULL)
+    return TID_ERROR;
+  sema_init (&info.started, 0);
+  info.success = false;
+
+  tid = thread_create (cur->name, PRI_DEFAULT, start_thread, &info);
+  if (tid == TID_ERROR)
+    {
+      free_stack_slot (info.leader, info.stack);
+      return TID_ERROR;
+    }
+  sema_down (&info.started);
+  if (!info.success)
+    {
+      /* Reap the thread, if it got as far as joining the
+         process. */
+      wait_for (tid, true);
+      return TID_ERROR;
+    }
+  return tid;
+}
+
+/* A thread function that joins the process that called
+   process_thread_create() and starts running it in user
+   mode. */
+static void
+start_thread (void *info_)
+{
+  struct thread_info *info = info_;
+  struct thread *leader = info->leader;
+  struct thread *t = thread_current ();
+  struct intr_frame if_;
+  void *frame[3];
+
+  /* Until the exit record exists, the leader would not wait for
+     us, so we cannot use anything of the process's yet. */
+  if (!exit_record_create (leader, true))
+    {
+      free_stack_slot (leader, info->stack);
+      sema_up (&info->started);
+      thread_exit ();
+    }
+
+  /* Join the process. */
+  t->leader = leader;
+  t->pagedir = leader->pagedir;
+  t->pages = leader->pages;
+  t->fd_table = leader->fd_table;
+  t->vdso = leader->vdso;
+  t->user_stack = info->stack;
+  process_activate ();
+
+  /* Push a null return address and the arguments on the new
+     stack.  ENTRY must not return. */
+  memset (&if_, 0, sizeof if_);
+  if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
+  if_.cs = SEL_UCSEG;
+  if_.eflags = FLAG_IF | FLAG_MBS;
+  if_.eip = (void (*) (void)) info->entry;
+  if_.esp = info->stack - sizeof frame;
+  t->user_esp = if_.esp;
+  frame[0] = NULL;
+  frame[1] = info->args[0];
+  frame[2] = info->args[1];
+
+  /* INFO is on the creator's stack, so it is gone once we up the
+     semaphore. */
+  info->success = copy_to_user (if_.esp, frame, sizeof frame);
+  if (!info->success)
+    {
+      sema_up (&info->started);
+      thread_exit ();
+    }
+  sema_up (&info->started);
+
+  /* The process may have been killed before we joined it. */
+  process_check_exit ();
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+/* Waits for TID, another thread in the current process, to exit
+   and returns its exit code, or -1 if it was killed.  Returns -1
+   at once if TID is not a thread of the current process or some
+   thread has already joined it. */
+int
+process_thread_join (tid_t tid)
+{
+  return wait_for (tid, true);
+}
+
+/* Terminates the current thread, reporting EXIT_CODE to a thread
+   that joins it.  If the current thread is the process's leader,
+   it waits for the other threads to exit first, and then the
+   process exits with EXIT_CODE. */
+void
+process_thread_exit (int exit_code)
+{
+  struct thread *cur = thread_current ();
+
+  if (cur->leader == cur)
+    {
+      wait_for_threads ();
+      process_kill (exit_code);
+    }
+  else
+    cur->exit_code = exit_code;
+  thread_exit ();
+}
+
+/* Returns the top of user stack slot SLOT. */
+static uint8_t *
+stack_slot_top (int slot)
+{
+  return (uint8_t *) PHYS_BASE - (size_t) slot * stack_max_pages * PGSIZE;
+}
+
+/* Returns the slot of the user stack whose top is TOP. */
+static int
+stack_slot (void *top)
+{
+  return ((uint8_t *) PHYS_BASE - (uint8_t *) top) / (stack_max_pages * PGSIZE);
+}
+
+/* Allocates a stack slot for a new thread in the current process
+   and returns the top of its stack, or a null pointer if every
+   slot is in use. */
+static uint8_t *
+alloc_stack_slot (void)
+{
+  struct thread *leader = thread_current ()->leader;
+  size_t slot_cnt = (((uintptr_t) PHYS_BASE - (uintptr_t) VDSO_BASE - PGSIZE)
+                     / (stack_max_pages * PGSIZE));
+  uint8_t *top = NULL;
+
+  if (slot_cnt > MAX_THREADS)
+    slot_cnt = MAX_THREADS;
+
+  lock_acquire (&process_table_lock);
+  if (leader->stack_slots != UINT32_MAX)
+    {
+      int slot = __builtin_ctz (~leader->stack_slots);
+      if ((size_t) slot < slot_cnt)
+        {
+          leader->stack_slots |= 1u << slot;
+          top = stack_slot_top (slot);
+        }
+    }
+  lock_release (&process_table_lock);
+  return top;
+}
+
+/* Frees the stack slot whose stack's top is TOP in the process
+   led by LEADER. */
+static void
+free_stack_slot (struct thread *leader, void *top)
+{
+  lock_acquire (&process_table_lock);
+  leader->stack_slots &= ~(1u << stack_slot (top));
+  lock_release (&process_table_lock);
+}
+#endif
+
+/* Creates an exit record for the current thread and adds it to
+   the process table.  If IS_THREAD is false, the current thread
+   is a new child process of the process whose leader is LEADER,
+   and the record goes on LEADER's children; otherwise it is a
+   new thread in LEADER's process, and the record goes on
+   LEADER's threads.  The thread that created the current one
+   must be blocked for the duration.
+   Returns true if successful, false if memory is short or, for
+   a new thread, if its process is already exiting. */
+static bool
+exit_record_create (struct thread *leader, bool is_thread)
+{
+  struct thread *cur = thread_current ();
+  struct exit_record *r = malloc (sizeof *r);
+  if (r == NULL)
+    return false;
+
+  r->tid = cur->tid;
+  r->parent = leader->tid;
+  r->is_thread = is_thread;
+  r->ref_cnt = 2;
+  r->exit_code = -1;
+  sema_init (&r->dead, 0);
+
+  lock_acquire (&process_table_lock);
+  if (is_thread && leader->exiting)
+    {
+      lock_release (&process_table_lock);
+      free (r);
+      return false;
+    }
+  hash_insert (&process_table, &r->hash_elem);
+  list_push_back (is_thread ? &leader->threads : &leader->children,
+                  &r->elem);
+  lock_release (&process_table_lock);
+
+  cur->exit_record = r;
+  return true;
+}
+
+/* Drops a reference to R, freeing it if it was the last one.
+   The caller must hold process_table_lock. */
+static void
+exit_record_release (struct exit_record *r)
+{
+  ASSERT (lock_held_by_current_thread (&process_table_lock));
+  ASSERT (r->ref_cnt > 0);
+
+  if (--r->ref_cnt == 0)
+    {
+      hash_delete (&process_table, &r->hash_elem);
+      free (r);
+    }
+}
+
 /* Waits for thread TID to die and returns its exit status.  If
    it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If TID is invalid or if it was not a
    child of the calling process, or if process_wait() has already
    been successfully called for the given TID, returns -1
-   immediately, without waiting.
-
-   This function will be implemented in problem 2-2.  For now, it
-   does nothing. */
+   immediately, without waiting.  Any thread of a process may
+   wait for any of the process's children. */
 int
-process_wait (tid_t child_tid UNUSED) 
+process_wait (tid_t child_tid) 
+{
+  return wait_for (child_tid, false);
+}
+
+/* Waits for TID, a child process of the current process if
+   IS_THREAD is false or another thread in it if IS_THREAD is
+   true, to die and returns its exit status, as described for
+   process_wait(). */
+static int
+wait_for (tid_t tid, bool is_thread)
+{
+  struct thread *cur = thread_current ();
+  struct exit_record key;
+  struct exit_record *r;
+  struct hash_elem *e;
+  int exit_code;
+
+  /* Once we start waiting for a child, we disown its record, so
+     that we cannot wait for it twice. */
+  key.tid = tid;
+  lock_acquire (&process_table_lock);
+  e = hash_find (&process_table, &key.hash_elem);
+  r = e != NULL ? hash_entry (e, struct exit_record, hash_elem) : NULL;
+  if (r != NULL && r->parent == cur->leader->tid
+      && r->is_thread == is_thread && r->tid != cur->tid)
+    {
+      list_remove (&r->elem);
+      r->parent = TID_ERROR;
+    }
+  else
+    r = NULL;
+  lock_release (&process_table_lock);
+  if (r == NULL)
+    return -1;
+
+  if (!sema_down_interruptible (&r->dead))
+    {
+      /* Our process is being killed.  Give a thread's record
+         back to the leader, which must still wait for the thread
+         before it tears down the process. */
+      lock_acquire (&process_table_lock);
+      if (is_thread)
+        {
+          r->parent = cur->leader->tid;
+          list_push_back (&cur->leader->threads, &r->elem);
+        }
+      else
+        exit_record_release (r);
+      lock_release (&process_table_lock);
+      return -1;
+    }
+  exit_code = r->exit_code;
+
+  lock_acquire (&process_table_lock);
+  exit_record_release (r);
+  lock_release (&process_table_lock);
+  return exit_code;
+}
+
+/* Marks the current process as exiting with EXIT_CODE, unless
+   it already is.  Each of its other threads terminates the next
+   time it would return to user mode.  Those blocked in
+   interruptible waits, for a pipe, a child, another thread, or
+   the keyboard, are woken so that they return at once. */
+void
+process_kill (int exit_code)
+{
+  struct thread *leader = thread_current ()->leader;
+  enum intr_level old_level;
+  bool killed = false;
+
+  lock_acquire (&process_table_lock);
+  if (!leader->exiting)
+    {
+      leader->exiting = true;
+      leader->exit_code = exit_code;
+      killed = true;
+    }
+  lock_release (&process_table_lock);
+
+  if (killed)
+    {
+      old_level = intr_disable ();
+      thread_foreach (interrupt_thread, leader);
+      intr_set_level (old_level);
+    }
+}
+
+/* Interrupts thread T if it is in the process led by LEADER,
+   other than the current thread.  A thread_foreach() action. */
+static void
+interrupt_thread (struct thread *t, void *leader)
+{
+  if (t->leader == leader && t != thread_current ())
+    thread_interrupt (t);
+}
+
+/* Terminates the current thread if its process is exiting.
+   Called on the way back to user mode. */
+void
+process_check_exit (void)
 {
-  return -1;
+  if (thread_current ()->leader->exiting)
+    {
+      intr_enable ();
+      thread_exit ();
+    }
+}
+
+/* Waits for all the current process's threads but the leader,
+   which must be the current thread, to die. */
+static void
+wait_for_threads (void)
+{
+  struct thread *cur = thread_current ();
+
+  ASSERT (cur->leader == cur);
+
+  lock_acquire (&process_table_lock);
+  while (!list_empty (&cur->threads))
+    {
+      struct list_elem *e = list_pop_front (&cur->threads);
+      struct exit_record *r = list_entry (e, struct exit_record, elem);
+
+      r->parent = TID_ERROR;
+      lock_release (&process_table_lock);
+      sema_down (&r->dead);
+      lock_acquire (&process_table_lock);
+      exit_record_release (r);
+    }
+  lock_release (&process_table_lock);
+}
+
+/* Reports the current thread's exit code to whoever waits for
+   it and gives up its exit record, if it has one. */
+static void
+report_exit (void)
+{
+  struct thread *cur = thread_current ();
+
+  lock_acquire (&process_table_lock);
+  if (cur->exit_record != NULL)
+    {
+      cur->exit_record->exit_code = cur->exit_code;
+      sema_up (&cur->exit_record->dead);
+      exit_record_release (cur->exit_record);
+      cur->exit_record = NULL;
+    }
+  lock_release (&process_table_lock);
 }
 
 /* Free the current process's resources. */
@@ -98,8 +713,54 @@ process_exit (void)
   struct thread *cur = thread_current ();
   uint32_t *pd;
 
+  /* A thread other than the leader gives up only its own stack.
+     Everything else belongs to the leader, which waits for it. */
+  if (cur->leader != cur)
+    {
+#ifdef VM
+      page_deallocate_range ((uint8_t *) cur->user_stack
+                             - stack_max_pages * PGSIZE, stack_max_pages);
+      free_stack_slot (cur->leader, cur->user_stack);
+      cur->pages = NULL;
+#endif
+      cur->fd_table = NULL;
+      cur->vdso = NULL;
+      cur->pagedir = NULL;
+      pagedir_activate (NULL);
+      report_exit ();
+      return;
+    }
+
+  /* Stop the other threads and wait for them to go. */
+  process_kill (-1);
+  wait_for_threads ();
+
+  if (cur->pagedir != NULL)
+    printf ("%s: exit(%d)\n", cur->name, cur->exit_code);
+
+  /* Close open files and unmap mapped ones. */
+  syscall_exit ();
+
+  /* Free the vDSO page before pagedir_destroy() would, so that
+     the timer stops updating it first. */
+  vdso_unmap ();
+
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
+#ifdef VM
+  /* Release the process's frames and close its executable.  This
+     must precede pagedir_destroy(), which would otherwise free
+     the frames out from under the frame table. */
+  page_table_destroy ();
+  if (cur->bin_file != NULL)
+    {
+      lock_acquire (&filesys_lock);
+      file_close (cur->bin_file);
+      lock_release (&filesys_lock);
+      cur->bin_file = NULL;
+    }
+#endif
+
   pd = cur->pagedir;
   if (pd != NULL) 
     {
@@ -114,6 +775,17 @@ process_exit (void)
       pagedir_activate (NULL);
       pagedir_destroy (pd);
     }
+
+  /* Report our exit code to our parent, now that everything we
+     held is released, and give up our children's records. */
+  report_exit ();
+  lock_acquire (&process_table_lock);
+  while (!list_empty (&cur->children))
+    {
+      struct list_elem *e = list_pop_front (&cur->children);
+      exit_record_release (list_entry (e, struct exit_record, elem));
+    }
+  lock_release (&process_table_lock);
 }
 
 /* Sets up the CPU for running user code in the current
@@ -130,6 +802,9 @@ process_activate (void)
   /* Set thread's kernel stack for use in processing
      interrupts. */
   tss_update ();
+
+  /* The vDSO page was not kept current while we were away. */
+  vdso_update (false);
 }
 
 /* We load ELF binaries.  The following definitions are taken
@@ -195,31 +870,48 @@ struct Elf32_Phdr
 #define PF_W 2          /* Writable. */
 #define PF_R 4          /* Readable. */
 
-static bool setup_stack (void **esp);
+static bool setup_stack (const char *cmd_line, void **esp);
 static bool validate_segment (const struct Elf32_Phdr *, struct file *);
 static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
                           uint32_t read_bytes, uint32_t zero_bytes,
                           bool writable);
 
-/* Loads an ELF executable from FILE_NAME into the current thread.
+/* Loads an ELF executable from the first word of CMD_LINE into
+   the current thread, passing it the words of CMD_LINE as
+   arguments.
    Stores the executable's entry point into *EIP
    and its initial stack pointer into *ESP.
    Returns true if successful, false otherwise. */
 bool
-load (const char *file_name, void (**eip) (void), void **esp) 
+load (const char *cmd_line, void (**eip) (void), void **esp) 
 {
   struct thread *t = thread_current ();
+  char file_name[NAME_MAX + 2];
   struct Elf32_Ehdr ehdr;
   struct file *file = NULL;
   off_t file_ofs;
   bool success = false;
   int i;
 
+  /* Extract the file name from the command line.  A name too long
+     to fit is too long to open, too. */
+  cmd_line += strspn (cmd_line, " ");
+  strlcpy (file_name, cmd_line, sizeof file_name);
+  file_name[strcspn (file_name, " ")] = '\0';
+
+  lock_acquire (&filesys_lock);
+
   /* Allocate and activate page directory. */
   t->pagedir = pagedir_create ();
   if (t->pagedir == NULL) 
     goto done;
   process_activate ();
+#ifdef VM
+  if (!page_table_create ())
+    goto done;
+#endif
+  if (!vdso_map ())
+    goto done;
 
   /* Open executable file. */
   file = filesys_open (file_name);
@@ -301,10 +993,6 @@ load (const char *file_name, void (**eip) (void), void **esp)
         }
     }
 
-  /* Set up stack. */
-  if (!setup_stack (esp))
-    goto done;
-
   /* Start address. */
   *eip = (void (*) (void)) ehdr.e_entry;
 
@@ -312,13 +1000,35 @@ load (const char *file_name, void (**eip) (void), void **esp)
 
  done:
   /* We arrive here whether the load is successful or not. */
+#ifdef VM
+  /* Keep the executable open, and unmodifiable, for as long as
+     its pages may still be faulted in from it. */
+  if (success)
+    {
+      file_deny_write (file);
+      t->bin_file = file;
+    }
+  else
+    file_close (file);
+#else
   file_close (file);
+#endif
+  lock_release (&filesys_lock);
+
+  /* Set up stack.  Faulting in the stack page may have to evict
+     another page to a file, so we must not hold the file system
+     lock here. */
+  if (success && !setup_stack (cmd_line, esp))
+    success = false;
+
   return success;
 }
 
 /* load() helpers. */
 
+#ifndef VM
 static bool install_page (void *upage, void *kpage, bool writable);
+#endif
 
 /* Checks whether PHDR describes a valid, loadable segment in
    FILE and returns true if so, false otherwise. */
@@ -378,7 +1088,11 @@ validate_segment (const struct Elf32_Phdr *phdr, struct file *file)
    user process if WRITABLE is true, read-only otherwise.
 
    Return true if successful, false if a memory allocation error
-   or disk read error occurs. */
+   or disk read error occurs.
+
+   With VM, nothing is read here: each page is recorded in the
+   supplemental page table and read or zeroed by the page fault
+   handler when the process first touches it. */
 static bool
 load_segment (struct file *file, off_t ofs, uint8_t *upage,
               uint32_t read_bytes, uint32_t zero_bytes, bool writable) 
@@ -387,6 +1101,30 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
   ASSERT (pg_ofs (upage) == 0);
   ASSERT (ofs % PGSIZE == 0);
 
+#ifdef VM
+  while (read_bytes > 0 || zero_bytes > 0) 
+    {
+      size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
+      size_t page_zero_bytes = PGSIZE - page_read_bytes;
+      struct page *p = page_alloc (upage, writable);
+      if (p == NULL)
+        return false;
+      if (page_read_bytes > 0)
+        {
+          p->type = PAGE_FILE;
+          p->file = file;
+          p->file_offset = ofs;
+          p->file_bytes = page_read_bytes;
+        }
+
+      /* Advance. */
+      read_bytes -= page_read_bytes;
+      zero_bytes -= page_zero_bytes;
+      ofs += page_read_bytes;
+      upage += PGSIZE;
+    }
+  return true;
+#else
   file_seek (file, ofs);
   while (read_bytes > 0 || zero_bytes > 0) 
     {
@@ -422,28 +1160,119 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       upage += PGSIZE;
     }
   return true;
+#endif
+}
+
+/* Pushes the SIZE bytes in BUF onto the stack in KPAGE, whose
+   page offset *OFS is the current stack top, padding them to a
+   multiple of the word size.  Returns the kernel virtual address
+   of the pushed copy, or a null pointer if the page is full. */
+static void *
+push (uint8_t *kpage, size_t *ofs, const void *buf, size_t size)
+{
+  size_t padsize = ROUND_UP (size, sizeof (uint32_t));
+  if (*ofs < padsize)
+    return NULL;
+
+  *ofs -= padsize;
+  memcpy (kpage + *ofs + (padsize - size), buf, size);
+  return kpage + *ofs + (padsize - size);
+}
+
+/* Lays out CMD_LINE in stack page KPAGE, which the process will
+   see at UPAGE, as the arguments to main(): the argument
+   strings, the argv[] array with its null terminator, argv,
+   argc, and a fake return address.  Sets *ESP to the user
+   address of the last.
+   Returns true if successful, false if the arguments do not fit
+   in one page. */
+static bool
+init_cmd_line (uint8_t *kpage, uint8_t *upage, const char *cmd_line,
+               void **esp)
+{
+  size_t ofs = PGSIZE;
+  char *const null = NULL;
+  char *cmd_line_copy;
+  char *karg, *save_ptr;
+  char **kargv;
+  char **argv;
+  int argc;
+  int i;
+
+  /* Push the command line string. */
+  cmd_line_copy = push (kpage, &ofs, cmd_line, strlen (cmd_line) + 1);
+  if (cmd_line_copy == NULL)
+    return false;
+
+  /* Push argv[argc], which is null, then split the string into
+     words in place and push the user address of each.  That
+     leaves argv[0...argc - 1] backward, so reverse them. */
+  if (push (kpage, &ofs, &null, sizeof null) == NULL)
+    return false;
+  argc = 0;
+  for (karg = strtok_r (cmd_line_copy, " ", &save_ptr); karg != NULL;
+       karg = strtok_r (NULL, " ", &save_ptr))
+    {
+      char *uarg = (char *) upage + (karg - (char *) kpage);
+      if (push (kpage, &ofs, &uarg, sizeof uarg) == NULL)
+        return false;
+      argc++;
+    }
+  kargv = (char **) (kpage + ofs);
+  for (i = 0; i < argc / 2; i++)
+    {
+      char *tmp = kargv[i];
+      kargv[i] = kargv[argc - 1 - i];
+      kargv[argc - 1 - i] = tmp;
+    }
+  argv = (char **) (upage + ofs);
+
+  /* Push argv, argc, and a null "return address". */
+  if (push (kpage, &ofs, &argv, sizeof argv) == NULL
+      || push (kpage, &ofs, &argc, sizeof argc) == NULL
+      || push (kpage, &ofs, &null, sizeof null) == NULL)
+    return false;
+
+  *esp = upage + ofs;
+  return true;
 }
 
 /* Create a minimal stack by mapping a zeroed page at the top of
-   user virtual memory. */
+   user virtual memory, and puts the words of CMD_LINE on it as
+   the arguments to main(). */
 static bool
-setup_stack (void **esp) 
+setup_stack (const char *cmd_line, void **esp) 
 {
+  uint8_t *upage = ((uint8_t *) PHYS_BASE) - PGSIZE;
+#ifdef VM
+  bool success;
+
+  /* The stack page is zero-fill like any other, but we lock it in
+     to fill in the arguments. */
+  if (page_alloc (upage, true) == NULL || !page_lock (upage, true))
+    return false;
+  success = init_cmd_line (pagedir_get_page (thread_current ()->pagedir,
+                                             upage),
+                           upage, cmd_line, esp);
+  page_unlock (upage);
+  return success;
+#else
   uint8_t *kpage;
   bool success = false;
 
   kpage = palloc_get_page (PAL_USER | PAL_ZERO);
   if (kpage != NULL) 
     {
-      success = install_page (((uint8_t *) PHYS_BASE) - PGSIZE, kpage, true);
-      if (success)
-        *esp = PHYS_BASE;
+      if (install_page (upage, kpage, true))
+        success = init_cmd_line (kpage, upage, cmd_line, esp);
       else
         palloc_free_page (kpage);
     }
   return success;
+#endif
 }
 
+#ifndef VM
 /* Adds a mapping from user virtual address UPAGE to kernel
    virtual address KPAGE to the page table.
    If WRITABLE is true, the user process may modify the page;
@@ -463,3 +1292,20 @@ install_page (void *upage, void *kpage, bool writable)
   return (pagedir_get_page (t->pagedir, upage) == NULL
           && pagedir_set_page (t->pagedir, upage, kpage, writable));
 }
+#endif
+
+/* Returns a hash value for exit record E. */
+static unsigned
+exit_record_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (hash_entry (e, struct exit_record, hash_elem)->tid);
+}
+
+/* Returns true if exit record A's tid precedes B's. */
+static bool
+exit_record_less (const struct hash_elem *a, const struct hash_elem *b,
+                  void *aux UNUSED)
+{
+  return (hash_entry (a, struct exit_record, hash_elem)->tid
+          < hash_entry (b, struct exit_record, hash_elem)->tid);
+}
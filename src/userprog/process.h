@@ -3,8 +3,19 @@
 
 #include "threads/thread.h"
 
+struct intr_frame;
+
+void process_init (void);
 tid_t process_execute (const char *file_name);
+#ifdef VM
+tid_t process_fork (void);
+tid_t process_thread_create (void *entry, void *func, void *aux);
+int process_thread_join (tid_t);
+void process_thread_exit (int exit_code) NO_RETURN;
+#endif
 int process_wait (tid_t);
+void process_kill (int exit_code);
+void process_check_exit (void);
 void process_exit (void);
 void process_activate (void);
 
@@ -1,20 +1,1826 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <round.h>
+#include <string.h>
 #include <syscall-nr.h>
+#include <syscall-ring.h>
+#include <uio.h>
+#include "userprog/gdt.h"
+#include "userprog/pagedir.h"
+#include "userprog/pipe.h"
+#include "userprog/process.h"
+#include "userprog/tss.h"
+#include "userprog/uaccess.h"
+#include "devices/input.h"
+#include "devices/shutdown.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
-static void syscall_handler (struct intr_frame *);
+/* System call entry points.  sysenter_entry, in
+   sysenter-stub.S, calls syscall_handler() too. */
+void syscall_handler (struct intr_frame *);
+void sysenter_entry (void);
+void sysenter_entry_tf_clear (void);
+static void sysenter_init (void);
+
+static void copy_in (void *, const void *, size_t);
+static void copy_out (void *, const void *, size_t);
+static char *copy_in_string (const char *);
+static void lock_user_page (const void *, bool will_write);
+static void unlock_user_page (const void *);
+
+static int sys_halt (void) NO_RETURN;
+static int sys_exit (int status) NO_RETURN;
+static int sys_exec (const char *ufile);
+static int sys_wait (tid_t);
+static int sys_create (const char *ufile, unsigned initial_size);
+static int sys_remove (const char *ufile);
+static int sys_open (const char *ufile);
+static int sys_filesize (int handle);
+static int sys_read (int handle, void *udst, unsigned size);
+static int sys_write (int handle, const void *usrc, unsigned size);
+static int sys_seek (int handle, unsigned position);
+static int sys_tell (int handle);
+static int sys_close (int handle);
+static int sys_ring_enter (struct ring *);
+static int sys_readv (int handle, const struct iovec *uiov, int iovcnt);
+static int sys_writev (int handle, const struct iovec *uiov, int iovcnt);
+static int sys_pread (int handle, void *udst, unsigned size,
+                      unsigned offset);
+static int sys_pwrite (int handle, const void *usrc, unsigned size,
+                       unsigned offset);
+static int sys_copyfile (int src_handle, int dst_handle, unsigned offset,
+                         unsigned size);
+static int sys_pipe (int *ufds);
+static int sys_dup (int handle);
+static int sys_dup2 (int old_handle, int new_handle);
+static int sys_fcntl (int handle, int cmd, int arg);
+#ifdef VM
+static int sys_mmap (int handle, void *addr);
+static int sys_munmap (int mapping);
+static int sys_fork (void);
+static int sys_thread_create (void *entry, void *func, void *aux);
+static int sys_thread_join (tid_t);
+static int sys_thread_exit (int status) NO_RETURN;
+#endif
+
+/* A system call handler.  Each takes as many of the arguments as
+   its table entry says, of whatever types it needs, all passed
+   as words. */
+typedef int syscall_function (int, int, int, int);
+
+/* A system call. */
+struct syscall
+  {
+    size_t arg_cnt;             /* Number of arguments. */
+    syscall_function *func;     /* Implementation. */
+  };
+
+/* Table entry for FUNC, which takes ARG_CNT arguments.  Going by
+   way of a function type with no arguments keeps GCC from warning
+   about the cast. */
+#define SYSCALL(ARG_CNT, FUNC) \
+        {ARG_CNT, (syscall_function *) (void (*) (void)) FUNC}
+
+/* Table of system calls, indexed by SYS_* number.  Calls without
+   an entry kill the process. */
+static const struct syscall syscall_table[] =
+  {
+    [SYS_HALT] = SYSCALL (0, sys_halt),
+    [SYS_EXIT] = SYSCALL (1, sys_exit),
+    [SYS_EXEC] = SYSCALL (1, sys_exec),
+    [SYS_WAIT] = SYSCALL (1, sys_wait),
+    [SYS_CREATE] = SYSCALL (2, sys_create),
+    [SYS_REMOVE] = SYSCALL (1, sys_remove),
+    [SYS_OPEN] = SYSCALL (1, sys_open),
+    [SYS_FILESIZE] = SYSCALL (1, sys_filesize),
+    [SYS_READ] = SYSCALL (3, sys_read),
+    [SYS_WRITE] = SYSCALL (3, sys_write),
+    [SYS_SEEK] = SYSCALL (2, sys_seek),
+    [SYS_TELL] = SYSCALL (1, sys_tell),
+    [SYS_CLOSE] = SYSCALL (1, sys_close),
+    [SYS_RING_ENTER] = SYSCALL (1, sys_ring_enter),
+    [SYS_READV] = SYSCALL (3, sys_readv),
+    [SYS_WRITEV] = SYSCALL (3, sys_writev),
+    [SYS_PREAD] = SYSCALL (4, sys_pread),
+    [SYS_PWRITE] = SYSCALL (4, sys_pwrite),
+    [SYS_COPYFILE] = SYSCALL (4, sys_copyfile),
+    [SYS_PIPE] = SYSCALL (1, sys_pipe),
+    [SYS_DUP] = SYSCALL (1, sys_dup),
+    [SYS_DUP2] = SYSCALL (2, sys_dup2),
+    [SYS_FCNTL] = SYSCALL (3, sys_fcntl),
+#ifdef VM
+    [SYS_MMAP] = SYSCALL (2, sys_mmap),
+    [SYS_MUNMAP] = SYSCALL (1, sys_munmap),
+    [SYS_FORK] = SYSCALL (0, sys_fork),
+    [SYS_THREAD_CREATE] = SYSCALL (3, sys_thread_create),
+    [SYS_THREAD_JOIN] = SYSCALL (1, sys_thread_join),
+    [SYS_THREAD_EXIT] = SYSCALL (1, sys_thread_exit),
+#endif
+  };
 
 void
-syscall_init (void) 
+syscall_init (void)
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
+  sysenter_init ();
+}
+
+/* Model-specific registers that SYSENTER loads the kernel code
+   segment, stack pointer, and entry point from.  See [IA32-v3a]
+   4.8.7 "Performing Fast Calls to System Procedures with the
+   SYSENTER and SYSEXIT Instructions". */
+#define MSR_SYSENTER_CS 0x174
+#define MSR_SYSENTER_ESP 0x175
+#define MSR_SYSENTER_EIP 0x176
+
+/* CPUID leaf 1 %edx bit that says SYSENTER and SYSEXIT exist. */
+#define CPUID_SEP (1u << 11)
+
+/* Writes VALUE to model-specific register MSR. */
+static inline void
+wrmsr (uint32_t msr, uint32_t value)
+{
+  asm volatile ("wrmsr" : : "c" (msr), "a" (value), "d" (0));
+}
+
+/* Returns true if the CPU supports SYSENTER and SYSEXIT.  Early
+   Pentium Pro parts set the CPUID bit without them. */
+static bool
+have_sysenter (void)
+{
+  uint32_t eax, ebx, ecx, edx;
+  unsigned family, model, stepping;
+
+  asm ("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (1));
+  family = (eax >> 8) & 0xf;
+  model = (eax >> 4) & 0xf;
+  stepping = eax & 0xf;
+  return ((edx & CPUID_SEP) != 0
+          && !(family == 6 && model < 3 && stepping < 3));
+}
+
+/* Stack that SYSENTER switches to.  The kernel stack changes
+   with every thread switch, so the stack pointer MSR cannot point
+   to it.  Instead sysenter_entry moves from here to the kernel
+   stack at once, by way of sysenter_esp0.  The only thing ever
+   pushed here is a #DB taken before that (see
+   syscall_in_sysenter_entry()). */
+static uint32_t sysenter_stack[256];
+
+/* Location of the ring 0 stack pointer in the TSS.  Read by
+   sysenter_entry. */
+void **sysenter_esp0;
+
+/* Enables the SYSENTER system call path on this CPU, if it has
+   one.  User programs check for it the same way and otherwise
+   use INT $0x30. */
+static void
+sysenter_init (void)
+{
+  if (!have_sysenter ())
+    return;
+  sysenter_esp0 = tss_esp0 ();
+  wrmsr (MSR_SYSENTER_CS, SEL_KCSEG);
+  wrmsr (MSR_SYSENTER_ESP,
+         (uint32_t) (sysenter_stack + sizeof sysenter_stack
+                                      / sizeof *sysenter_stack));
+  wrmsr (MSR_SYSENTER_EIP, (uint32_t) sysenter_entry);
+}
+
+/* Returns true if EIP is in the first instructions of
+   sysenter_entry, which run on the entry stack with whatever
+   trap flag the user had.  A #DB there comes from a user
+   program single-stepping into SYSENTER, not from a kernel
+   bug. */
+bool
+syscall_in_sysenter_entry (void (*eip) (void))
+{
+  return ((uintptr_t) eip >= (uintptr_t) sysenter_entry
+          && (uintptr_t) eip <= (uintptr_t) sysenter_entry_tf_clear);
+}
+
+/* System call handler.  The call number is at the user stack
+   pointer and its arguments follow it, one word each. */
+void
+syscall_handler (struct intr_frame *f)
+{
+  const struct syscall *sc;
+  unsigned call_nr;
+  int args[4];
+
+#ifdef VM
+  /* Save the user stack pointer, for stack growth on faults in
+     the kernel. */
+  thread_current ()->user_esp = f->esp;
+#endif
+
+  /* Get the system call. */
+  copy_in (&call_nr, f->esp, sizeof call_nr);
+  if (call_nr >= sizeof syscall_table / sizeof *syscall_table
+      || syscall_table[call_nr].func == NULL)
+    {
+      process_kill (-1);
+      thread_exit ();
+    }
+  sc = syscall_table + call_nr;
+
+  /* Get the system call arguments. */
+  ASSERT (sc->arg_cnt <= sizeof args / sizeof *args);
+  memset (args, 0, sizeof args);
+  copy_in (args, (uint32_t *) f->esp + 1, sizeof *args * sc->arg_cnt);
+
+  /* Execute the system call,
+     and set the return value. */
+  f->eax = sc->func (args[0], args[1], args[2], args[3]);
+
+  /* If another thread ended the process meanwhile, do not go
+     back to user mode.  intr_handler() checks the same on the way
+     out of an interrupt, but SYSENTER does not go through it. */
+  process_check_exit ();
+}
+
+/* Locks the user page containing UADDR into memory, so that the
+   kernel can touch it without faulting, even while holding
+   filesys_lock.  If WILL_WRITE is true, the page must be
+   writable.  Returns false if UADDR is not a valid user
+   address. */
+static bool
+try_lock_user_page (const void *uaddr, bool will_write)
+{
+#ifdef VM
+  return page_lock (uaddr, will_write);
+#else
+  uint32_t *pd = thread_current ()->pagedir;
+
+  return (is_user_vaddr (uaddr)
+          && pagedir_get_page (pd, uaddr) != NULL
+          && (!will_write || pagedir_is_writable (pd, uaddr)));
+#endif
+}
+
+/* Locks the user page containing UADDR into memory, as
+   try_lock_user_page() does, but kills the process if UADDR is
+   not a valid user address. */
+static void
+lock_user_page (const void *uaddr, bool will_write)
+{
+  if (!try_lock_user_page (uaddr, will_write))
+    {
+      process_kill (-1);
+      thread_exit ();
+    }
+}
+
+/* Unlocks a page locked with lock_user_page() or
+   try_lock_user_page(). */
+static void
+unlock_user_page (const void *uaddr UNUSED)
+{
+#ifdef VM
+  page_unlock (uaddr);
+#endif
+}
+
+/* Copies SIZE bytes from user address USRC to kernel address
+   DST.
+   Kills the process if any of the user accesses are invalid. */
+static void
+copy_in (void *dst, const void *usrc, size_t size)
+{
+  if (!copy_from_user (dst, usrc, size))
+    {
+      process_kill (-1);
+      thread_exit ();
+    }
+}
+
+/* Copies SIZE bytes from kernel address SRC to user address
+   UDST.
+   Kills the process if any of the user accesses are invalid. */
+static void
+copy_out (void *udst, const void *src, size_t size)
+{
+  if (!copy_to_user (udst, src, size))
+    {
+      process_kill (-1);
+      thread_exit ();
+    }
+}
+
+/* Creates a copy of user string US in kernel memory
+   and returns it as a page that must be freed with
+   palloc_free_page().
+   Truncates the string at PGSIZE bytes in size.
+   Kills the process if any of the user accesses are invalid. */
+static char *
+copy_in_string (const char *us)
+{
+  char *ks;
+  size_t length;
+
+  ks = palloc_get_page (0);
+  if (ks == NULL)
+    {
+      process_kill (-1);
+      thread_exit ();
+    }
+
+  for (length = 0; length < PGSIZE; length++)
+    {
+      if (!get_user ((uint8_t *) ks + length, (const uint8_t *) us + length))
+        {
+          palloc_free_page (ks);
+          process_kill (-1);
+          thread_exit ();
+        }
+      if (ks[length] == '\0')
+        return ks;
+    }
+  ks[PGSIZE - 1] = '\0';
+  return ks;
+}
+
+/* Halt system call. */
+static int
+sys_halt (void)
+{
+  shutdown_power_off ();
+}
+
+/* Exit system call. */
+static int
+sys_exit (int exit_code)
+{
+  process_kill (exit_code);
+  thread_exit ();
+}
+
+/* Exec system call. */
+static int
+sys_exec (const char *ufile)
+{
+  tid_t tid;
+  char *kfile = copy_in_string (ufile);
+
+  tid = process_execute (kfile);
+  palloc_free_page (kfile);
+
+  return tid;
+}
+
+/* Wait system call. */
+static int
+sys_wait (tid_t child)
+{
+  return process_wait (child);
+}
+
+/* Create system call. */
+static int
+sys_create (const char *ufile, unsigned initial_size)
+{
+  char *kfile = copy_in_string (ufile);
+  bool ok;
+
+  lock_acquire (&filesys_lock);
+  ok = filesys_create (kfile, initial_size);
+  lock_release (&filesys_lock);
+
+  palloc_free_page (kfile);
+
+  return ok;
+}
+
+/* Remove system call. */
+static int
+sys_remove (const char *ufile)
+{
+  char *kfile = copy_in_string (ufile);
+  bool ok;
+
+  lock_acquire (&filesys_lock);
+  ok = filesys_remove (kfile);
+  lock_release (&filesys_lock);
+
+  palloc_free_page (kfile);
+
+  return ok;
+}
+
+/* Kinds of object that a file descriptor can refer to. */
+enum fd_type
+  {
+    FD_CONSOLE,                 /* Keyboard for input, display for output. */
+    FD_FILE,                    /* Open file. */
+    FD_PIPE_READ,               /* Read end of a pipe. */
+    FD_PIPE_WRITE               /* Write end of a pipe. */
+  };
+
+/* A file descriptor, for binding a file handle to a file, a
+   pipe end, or the console. */
+struct file_descriptor
+  {
+    struct list_elem elem;      /* fd_table `closed' list element. */
+    enum fd_type type;          /* Kind of object. */
+    struct file *file;          /* File, if FD_FILE. */
+    struct pipe *pipe;          /* Pipe, if FD_PIPE_READ or FD_PIPE_WRITE. */
+    int handle;                 /* File handle, or -1 once closed. */
+    bool cloexec;               /* Close on exec? */
+    int users;                  /* Number of system calls using it. */
+  };
+
+/* A process's file descriptor table.
+
+   File descriptors are kept in an array indexed by handle, so
+   that looking one up, as nearly every file system call does,
+   takes constant time no matter how many files are open.  A
+   bitmap with one bit per slot, set if the slot is in use, lets
+   install_fd() find the lowest free handle a word at a time.
+   The table starts with FD_TABLE_MIN slots and doubles in size
+   when it fills, up to FD_TABLE_MAX.
+
+   All the threads of a process share its table, so the table
+   has a lock.  A system call that looks up a descriptor counts
+   itself as a user of it until it calls release_fd(), and a
+   descriptor closed by another thread in the meantime waits on
+   the `closed' list until its last user is done. */
+struct fd_table
+  {
+    struct lock lock;                   /* Protects the members below. */
+    struct file_descriptor **fds;       /* Indexed by handle. */
+    uint32_t *used;                     /* Bit set for each slot in use. */
+    int size;                           /* Number of slots. */
+    struct list closed;                 /* Closed descriptors still in use. */
+  };
+
+/* Bits in a word of fd_table's `used' bitmap. */
+#define FD_WORD_BITS 32
+
+/* Initial and greatest number of slots in a file descriptor
+   table.  Both must be multiples of FD_WORD_BITS. */
+#define FD_TABLE_MIN 32
+#define FD_TABLE_MAX 1024
+
+/* Creates and returns an empty file descriptor table, or a null
+   pointer if memory is short. */
+static struct fd_table *
+fd_table_create (void)
+{
+  struct fd_table *t = malloc (sizeof *t);
+  if (t == NULL)
+    return NULL;
+
+  lock_init (&t->lock);
+  t->fds = calloc (FD_TABLE_MIN, sizeof *t->fds);
+  t->used = calloc (FD_TABLE_MIN / FD_WORD_BITS, sizeof *t->used);
+  t->size = FD_TABLE_MIN;
+  list_init (&t->closed);
+  if (t->fds == NULL || t->used == NULL)
+    {
+      free (t->fds);
+      free (t->used);
+      free (t);
+      return NULL;
+    }
+  return t;
+}
+
+/* Grows table T to have more than HANDLE slots.
+   Returns true if successful, false if HANDLE is too big or
+   memory is short. */
+static bool
+fd_table_grow (struct fd_table *t, int handle)
+{
+  struct file_descriptor **fds;
+  uint32_t *used;
+  int size;
+
+  if (handle < t->size)
+    return true;
+  if (handle >= FD_TABLE_MAX)
+    return false;
+
+  size = t->size;
+  while (size <= handle)
+    size *= 2;
+
+  fds = realloc (t->fds, size * sizeof *fds);
+  if (fds == NULL)
+    return false;
+  t->fds = fds;
+  used = realloc (t->used, size / FD_WORD_BITS * sizeof *used);
+  if (used == NULL)
+    return false;
+  t->used = used;
+
+  memset (t->fds + t->size, 0, (size - t->size) * sizeof *fds);
+  memset (t->used + t->size / FD_WORD_BITS, 0,
+          (size - t->size) / FD_WORD_BITS * sizeof *used);
+  t->size = size;
+  return true;
+}
+
+/* Returns a new file descriptor of the given TYPE that refers to
+   nothing yet and has no handle, or a null pointer if memory is
+   short. */
+static struct file_descriptor *
+new_fd (enum fd_type type)
+{
+  struct file_descriptor *fd = malloc (sizeof *fd);
+  if (fd != NULL)
+    {
+      fd->type = type;
+      fd->file = NULL;
+      fd->pipe = NULL;
+      fd->handle = -1;
+      fd->cloexec = false;
+      fd->users = 0;
+    }
+  return fd;
+}
+
+/* Adds FD to table T under HANDLE, growing T if necessary.
+   HANDLE must not be in use.  The caller must hold T's lock,
+   unless no other thread can see T yet.
+   Returns HANDLE if successful, -1 on failure. */
+static int
+install_fd_at (struct fd_table *t, struct file_descriptor *fd, int handle)
+{
+  if (!fd_table_grow (t, handle))
+    return -1;
+
+  ASSERT (t->fds[handle] == NULL);
+  t->fds[handle] = fd;
+  t->used[handle / FD_WORD_BITS] |= 1u << (handle % FD_WORD_BITS);
+  fd->handle = handle;
+  return handle;
+}
+
+/* Gives FD the lowest free handle in the current process's file
+   descriptor table.  Returns the handle, or -1 if the table is
+   full, in which case the caller still owns FD. */
+static int
+install_fd (struct file_descriptor *fd)
+{
+  struct fd_table *t = thread_current ()->fd_table;
+  int handle;
+  int word;
+
+  lock_acquire (&t->lock);
+  for (word = 0; word < t->size / FD_WORD_BITS; word++)
+    if (t->used[word] != UINT32_MAX)
+      break;
+  handle = word * FD_WORD_BITS;
+  if (word < t->size / FD_WORD_BITS)
+    handle += __builtin_ctz (~t->used[word]);
+  handle = install_fd_at (t, fd, handle);
+  lock_release (&t->lock);
+
+  return handle;
+}
+
+/* Returns a new file descriptor, with no handle, that refers to
+   the same object as FD: another opening of the same file, at
+   the same position, another reference to the same pipe end, or
+   the console.  Returns a null pointer on failure.
+   The caller must hold filesys_lock. */
+static struct file_descriptor *
+dup_fd (const struct file_descriptor *fd)
+{
+  struct file_descriptor *copy = new_fd (fd->type);
+  if (copy == NULL)
+    return NULL;
+
+  switch (fd->type)
+    {
+    case FD_CONSOLE:
+      break;
+
+    case FD_FILE:
+      copy->file = file_reopen (fd->file);
+      if (copy->file == NULL)
+        {
+          free (copy);
+          return NULL;
+        }
+      file_seek (copy->file, file_tell (fd->file));
+      break;
+
+    case FD_PIPE_READ:
+    case FD_PIPE_WRITE:
+      copy->pipe = fd->pipe;
+      pipe_open (fd->pipe, fd->type == FD_PIPE_WRITE);
+      break;
+    }
+  return copy;
+}
+
+/* Closes whatever FD refers to and frees it.  FD must not be in
+   a file descriptor table or in use. */
+static void
+free_fd (struct file_descriptor *fd)
+{
+  switch (fd->type)
+    {
+    case FD_CONSOLE:
+      break;
+
+    case FD_FILE:
+      lock_acquire (&filesys_lock);
+      file_close (fd->file);
+      lock_release (&filesys_lock);
+      break;
+
+    case FD_PIPE_READ:
+    case FD_PIPE_WRITE:
+      pipe_close (fd->pipe, fd->type == FD_PIPE_WRITE);
+      break;
+    }
+  free (fd);
+}
+
+/* Removes FD from table T, whose lock the caller must hold, if
+   another thread has not already done so.  Returns true if no
+   system call is using FD, in which case the caller must free
+   it.  Otherwise, release_fd() frees it when its last user is
+   done, and the return value is false. */
+static bool
+remove_fd (struct fd_table *t, struct file_descriptor *fd)
+{
+  int handle = fd->handle;
+
+  if (handle < 0)
+    return false;
+  t->fds[handle] = NULL;
+  t->used[handle / FD_WORD_BITS] &= ~(1u << (handle % FD_WORD_BITS));
+  fd->handle = -1;
+
+  if (fd->users == 0)
+    return true;
+  list_push_back (&t->closed, &fd->elem);
+  return false;
+}
+
+/* Removes FD from the current process's file descriptor table
+   and closes whatever it refers to, as soon as no system call is
+   using it. */
+static void
+close_fd (struct file_descriptor *fd)
+{
+  struct fd_table *t = thread_current ()->fd_table;
+  bool unused;
+
+  lock_acquire (&t->lock);
+  unused = remove_fd (t, fd);
+  lock_release (&t->lock);
+
+  if (unused)
+    free_fd (fd);
+}
+
+/* Open system call. */
+static int
+sys_open (const char *ufile)
+{
+  char *kfile = copy_in_string (ufile);
+  struct file_descriptor *fd;
+  int handle = -1;
+
+  fd = new_fd (FD_FILE);
+  if (fd != NULL)
+    {
+      lock_acquire (&filesys_lock);
+      fd->file = filesys_open (kfile);
+      lock_release (&filesys_lock);
+      if (fd->file != NULL)
+        handle = install_fd (fd);
+      if (handle < 0)
+        free_fd (fd);
+    }
+
+  palloc_free_page (kfile);
+  return handle;
+}
+
+/* Returns the file descriptor associated with the given handle,
+   which stays valid, even if another thread closes it, until
+   the caller passes it to release_fd().
+   Terminates the process if HANDLE is not associated with an
+   open file. */
+static struct file_descriptor *
+lookup_fd (int handle)
+{
+  struct fd_table *t = thread_current ()->fd_table;
+  struct file_descriptor *fd;
+
+  lock_acquire (&t->lock);
+  fd = handle >= 0 && handle < t->size ? t->fds[handle] : NULL;
+  if (fd != NULL)
+    fd->users++;
+  lock_release (&t->lock);
+
+  if (fd == NULL)
+    {
+      process_kill (-1);
+      thread_exit ();
+    }
+  return fd;
+}
+
+/* Ends a use of FD that began with lookup_fd().  Frees FD if it
+   was closed in the meantime and this was its last use.
+
+   A thread killed in the middle of a system call never releases
+   the descriptors it is using.  Such a kill always ends the whole
+   process, so those are freed soon after, by syscall_exit(). */
+static void
+release_fd (struct file_descriptor *fd)
+{
+  struct fd_table *t = thread_current ()->fd_table;
+  bool unused;
+
+  lock_acquire (&t->lock);
+  ASSERT (fd->users > 0);
+  unused = --fd->users == 0 && fd->handle < 0;
+  if (unused)
+    list_remove (&fd->elem);
+  lock_release (&t->lock);
+
+  if (unused)
+    free_fd (fd);
+}
+
+/* Returns the file descriptor associated with the given handle,
+   as lookup_fd() does, if it refers to a file.  Returns a null
+   pointer, with nothing to release, if it refers to a pipe or
+   the console.
+   Terminates the process if HANDLE is not open. */
+static struct file_descriptor *
+lookup_file (int handle)
+{
+  struct file_descriptor *fd = lookup_fd (handle);
+
+  if (fd->type != FD_FILE)
+    {
+      release_fd (fd);
+      return NULL;
+    }
+  return fd;
+}
+
+/* Filesize system call. */
+static int
+sys_filesize (int handle)
+{
+  struct file_descriptor *fd = lookup_file (handle);
+  int size;
+
+  if (fd == NULL)
+    return -1;
+
+  lock_acquire (&filesys_lock);
+  size = file_length (fd->file);
+  lock_release (&filesys_lock);
+  release_fd (fd);
+
+  return size;
+}
+
+/* Read system call. */
+static int
+sys_read (int handle, void *udst_, unsigned size)
+{
+  uint8_t *udst = udst_;
+  struct file_descriptor *fd = lookup_fd (handle);
+  int bytes_read = 0;
+
+  switch (fd->type)
+    {
+    case FD_CONSOLE:
+      /* Handle keyboard reads.  Stop early if the process is
+         killed meanwhile. */
+      for (bytes_read = 0; (size_t) bytes_read < size; bytes_read++)
+        {
+          uint8_t key;
+
+          if (!input_getc_interruptible (&key))
+            break;
+          if (!put_user (udst + bytes_read, key))
+            {
+              process_kill (-1);
+              thread_exit ();
+            }
+        }
+      break;
+
+    case FD_PIPE_READ:
+      bytes_read = pipe_read (fd->pipe, udst, size);
+      break;
+
+    case FD_PIPE_WRITE:
+      bytes_read = -1;
+      break;
+
+    case FD_FILE:
+      /* Handle file reads. */
+      while (size > 0)
+        {
+          /* How much to read into this page? */
+          size_t page_left = PGSIZE - pg_ofs (udst);
+          size_t read_amt = size < page_left ? size : page_left;
+          off_t retval;
+
+          /* Read from file into page. */
+          lock_user_page (udst, true);
+          lock_acquire (&filesys_lock);
+          retval = file_read (fd->file, udst, read_amt);
+          lock_release (&filesys_lock);
+          unlock_user_page (udst);
+
+          /* Check success. */
+          if (retval < 0)
+            {
+              if (bytes_read == 0)
+                bytes_read = -1;
+              break;
+            }
+          bytes_read += retval;
+          if (retval != (off_t) read_amt)
+            {
+              /* Short read, so we're done. */
+              break;
+            }
+
+          /* Advance. */
+          udst += retval;
+          size -= retval;
+        }
+      break;
+    }
+
+  release_fd (fd);
+  return bytes_read;
+}
+
+/* Write system call. */
+static int
+sys_write (int handle, const void *usrc_, unsigned size)
+{
+  const uint8_t *usrc = usrc_;
+  struct file_descriptor *fd = lookup_fd (handle);
+  int bytes_written = 0;
+
+  switch (fd->type)
+    {
+    case FD_PIPE_WRITE:
+      bytes_written = pipe_write (fd->pipe, usrc, size);
+      break;
+
+    case FD_PIPE_READ:
+      bytes_written = -1;
+      break;
+
+    case FD_CONSOLE:
+    case FD_FILE:
+      while (size > 0)
+        {
+          /* How much bytes to write to this page? */
+          size_t page_left = PGSIZE - pg_ofs (usrc);
+          size_t write_amt = size < page_left ? size : page_left;
+          off_t retval;
+
+          /* Write from page into file.  Console output goes
+             straight from the user's page to the console, with no
+             copy. */
+          lock_user_page (usrc, false);
+          if (fd->type == FD_CONSOLE)
+            {
+              putbuf ((const char *) usrc, write_amt);
+              retval = write_amt;
+            }
+          else
+            {
+              lock_acquire (&filesys_lock);
+              retval = file_write (fd->file, usrc, write_amt);
+              lock_release (&filesys_lock);
+            }
+          unlock_user_page (usrc);
+
+          /* Handle return value. */
+          if (retval < 0)
+            {
+              if (bytes_written == 0)
+                bytes_written = -1;
+              break;
+            }
+          bytes_written += retval;
+
+          /* If it was a short write we're done. */
+          if (retval != (off_t) write_amt)
+            break;
+
+          /* Advance. */
+          usrc += retval;
+          size -= retval;
+        }
+      break;
+    }
+
+  release_fd (fd);
+  return bytes_written;
+}
+
+/* Seek system call. */
+static int
+sys_seek (int handle, unsigned position)
+{
+  struct file_descriptor *fd = lookup_file (handle);
+
+  if (fd == NULL)
+    return 0;
+
+  lock_acquire (&filesys_lock);
+  if ((off_t) position >= 0)
+    file_seek (fd->file, position);
+  lock_release (&filesys_lock);
+  release_fd (fd);
+
+  return 0;
+}
+
+/* Tell system call. */
+static int
+sys_tell (int handle)
+{
+  struct file_descriptor *fd = lookup_file (handle);
+  unsigned position;
+
+  if (fd == NULL)
+    return -1;
+
+  lock_acquire (&filesys_lock);
+  position = file_tell (fd->file);
+  lock_release (&filesys_lock);
+  release_fd (fd);
+
+  return position;
+}
+
+/* Close system call. */
+static int
+sys_close (int handle)
+{
+  struct file_descriptor *fd = lookup_fd (handle);
+
+  close_fd (fd);
+  release_fd (fd);
+  return 0;
 }
 
+/* Pipe system call.  Creates a pipe and stores handles for its
+   read and write ends in UFDS[0] and UFDS[1].  Returns 0 if
+   successful, -1 on failure. */
+static int
+sys_pipe (int *ufds)
+{
+  struct file_descriptor *rfd, *wfd;
+  struct pipe *pipe;
+  int fds[2];
+
+  /* Check the user buffer before creating anything. */
+  copy_in (fds, ufds, sizeof fds);
+
+  rfd = new_fd (FD_PIPE_READ);
+  wfd = new_fd (FD_PIPE_WRITE);
+  pipe = rfd != NULL && wfd != NULL ? pipe_create () : NULL;
+  if (pipe == NULL)
+    {
+      free (rfd);
+      free (wfd);
+      return -1;
+    }
+  rfd->pipe = wfd->pipe = pipe;
+  fds[0] = install_fd (rfd);
+  fds[1] = fds[0] >= 0 ? install_fd (wfd) : -1;
+  if (fds[1] < 0)
+    {
+      /* Each end holds one of the pipe's references, so freeing
+         both frees the pipe. */
+      if (fds[0] >= 0)
+        close_fd (rfd);
+      else
+        free_fd (rfd);
+      free_fd (wfd);
+      return -1;
+    }
+
+  copy_out (ufds, fds, sizeof fds);
+  return 0;
+}
+
+/* Dup system call.  Returns the lowest free handle, made to
+   refer to the object that HANDLE refers to, or -1 on failure.
+   The new handle is not closed on exec. */
+static int
+sys_dup (int handle)
+{
+  struct file_descriptor *fd = lookup_fd (handle);
+  struct file_descriptor *copy;
+  int new_handle;
+
+  lock_acquire (&filesys_lock);
+  copy = dup_fd (fd);
+  lock_release (&filesys_lock);
+  release_fd (fd);
+  if (copy == NULL)
+    return -1;
+
+  new_handle = install_fd (copy);
+  if (new_handle < 0)
+    free_fd (copy);
+  return new_handle;
+}
+
+/* Dup2 system call.  Makes handle NEW_HANDLE refer to the object
+   that OLD_HANDLE refers to, closing whatever it referred to
+   before.  The new handle is not closed on exec.  Returns
+   NEW_HANDLE, or -1 on failure. */
+static int
+sys_dup2 (int old_handle, int new_handle)
+{
+  struct fd_table *t = thread_current ()->fd_table;
+  struct file_descriptor *fd = lookup_fd (old_handle);
+  struct file_descriptor *copy, *old;
+
+  if (new_handle < 0 || new_handle >= FD_TABLE_MAX
+      || new_handle == old_handle)
+    {
+      release_fd (fd);
+      return new_handle == old_handle ? new_handle : -1;
+    }
+
+  lock_acquire (&filesys_lock);
+  copy = dup_fd (fd);
+  lock_release (&filesys_lock);
+  release_fd (fd);
+  if (copy == NULL)
+    return -1;
+
+  /* Replace the old descriptor in one step, so that no other
+     thread sees NEW_HANDLE closed in between. */
+  lock_acquire (&t->lock);
+  old = new_handle < t->size ? t->fds[new_handle] : NULL;
+  if (old != NULL && !remove_fd (t, old))
+    old = NULL;
+  if (install_fd_at (t, copy, new_handle) < 0)
+    new_handle = -1;
+  lock_release (&t->lock);
+
+  if (old != NULL)
+    free_fd (old);
+  if (new_handle < 0)
+    free_fd (copy);
+  return new_handle;
+}
+
+/* Fcntl system call.  Carries out CMD, one of the F_* commands in
+   <fcntl.h>, on HANDLE.  Returns a value that depends on CMD, or
+   -1 if CMD is unknown. */
+static int
+sys_fcntl (int handle, int cmd, int arg)
+{
+  struct file_descriptor *fd = lookup_fd (handle);
+  int retval;
+
+  switch (cmd)
+    {
+    case F_GETFD:
+      retval = fd->cloexec ? FD_CLOEXEC : 0;
+      break;
+
+    case F_SETFD:
+      fd->cloexec = (arg & FD_CLOEXEC) != 0;
+      retval = 0;
+      break;
+
+    default:
+      retval = -1;
+      break;
+    }
+
+  release_fd (fd);
+  return retval;
+}
+
+/* Vectored and positional I/O.
+
+   These check the user's buffers in a single pass, by locking
+   every page of them into memory up front, as read and write do
+   one page at a time.  The data then moves directly between those
+   pages and the file, with all of the file accesses in a single
+   filesys_lock critical section.  Pipes and the console likewise
+   take the whole vector at once.
+
+   So that one request cannot tie up all of user memory, at most
+   IO_MAX_PAGES pages are locked at a time.  A file transfer whose
+   buffers span more pages than that, 256 kB or more, is carried
+   out in pieces of IO_MAX_PAGES pages, each in its own critical
+   section, and so is atomic with respect to other readers and
+   writers only piece by piece. */
+
+/* Most user pages that vectored I/O locks into memory at once. */
+#define IO_MAX_PAGES 64
+
+/* A position within an array of user buffers. */
+struct iov_cursor
+  {
+    const struct iovec *iov;    /* Buffers, in kernel memory. */
+    int cnt;                    /* Number of buffers. */
+    int idx;                    /* Current buffer. */
+    size_t ofs;                 /* Offset in current buffer. */
+  };
+
+/* User pages locked into memory by lock_iov(). */
+struct locked_pages
+  {
+    const void *pages[IO_MAX_PAGES];    /* Page addresses. */
+    size_t cnt;                         /* Number of pages. */
+  };
+
+/* Advances C by SIZE bytes, which must not go past the end of
+   the current buffer, and past any empty buffers that follow. */
+static void
+iov_advance (struct iov_cursor *c, size_t size)
+{
+  c->ofs += size;
+  while (c->idx < c->cnt && c->ofs == c->iov[c->idx].iov_len)
+    {
+      c->idx++;
+      c->ofs = 0;
+    }
+}
+
+/* Unlocks the pages in LP. */
 static void
-syscall_handler (struct intr_frame *f UNUSED) 
+unlock_pages (struct locked_pages *lp)
+{
+  size_t i;
+
+  for (i = 0; i < lp->cnt; i++)
+    unlock_user_page (lp->pages[i]);
+  lp->cnt = 0;
+}
+
+/* Locks into memory the pages of the user buffers from C onward,
+   up to IO_MAX_PAGES pages, recording them in LP.  If WILL_WRITE
+   is true, the pages must be writable.  Returns the number of
+   bytes of buffers that the locked pages cover, without
+   advancing C.  Kills the process, with nothing left locked, if a
+   buffer is bad. */
+static size_t
+lock_iov (const struct iov_cursor *c_, struct locked_pages *lp,
+          bool will_write)
+{
+  struct iov_cursor c = *c_;
+  size_t size = 0;
+
+  lp->cnt = 0;
+  while (c.idx < c.cnt)
+    {
+      const uint8_t *ubuf = (const uint8_t *) c.iov[c.idx].iov_base + c.ofs;
+      const void *page = pg_round_down (ubuf);
+      size_t chunk = c.iov[c.idx].iov_len - c.ofs;
+      size_t i;
+
+      if (chunk > PGSIZE - pg_ofs (ubuf))
+        chunk = PGSIZE - pg_ofs (ubuf);
+
+      /* Buffers may share pages, but a page is locked only
+         once. */
+      for (i = 0; i < lp->cnt; i++)
+        if (lp->pages[i] == page)
+          break;
+      if (i == lp->cnt)
+        {
+          if (lp->cnt == IO_MAX_PAGES)
+            break;
+          if (!try_lock_user_page (page, will_write))
+            {
+              unlock_pages (lp);
+              process_kill (-1);
+              thread_exit ();
+            }
+          lp->pages[lp->cnt++] = page;
+        }
+
+      size += chunk;
+      iov_advance (&c, chunk);
+    }
+  return size;
+}
+
+/* Transfers SIZE bytes between the file open as FD and the user
+   buffers at C, which must be locked into memory, in the
+   direction given by WRITE, and advances C past them.  Starts at
+   byte offset *OFS, advancing it, or at the file position if *OFS
+   is negative.  Returns the number of bytes transferred, which is
+   less than SIZE only at end of file. */
+static size_t
+file_iov_io (struct file_descriptor *fd, struct iov_cursor *c, size_t size,
+             off_t *ofs, bool write)
 {
-  printf ("system call!\n");
+  size_t done = 0;
+
+  lock_acquire (&filesys_lock);
+  while (done < size)
+    {
+      uint8_t *ubuf = (uint8_t *) c->iov[c->idx].iov_base + c->ofs;
+      size_t chunk = c->iov[c->idx].iov_len - c->ofs;
+      off_t retval;
+
+      if (chunk > size - done)
+        chunk = size - done;
+      if (*ofs < 0)
+        retval = (write
+                  ? file_write (fd->file, ubuf, chunk)
+                  : file_read (fd->file, ubuf, chunk));
+      else
+        {
+          retval = (write
+                    ? file_write_at (fd->file, ubuf, chunk, *ofs)
+                    : file_read_at (fd->file, ubuf, chunk, *ofs));
+          *ofs += retval;
+        }
+
+      done += retval;
+      iov_advance (c, retval);
+      if (retval != (off_t) chunk)
+        break;
+    }
+  lock_release (&filesys_lock);
+  return done;
+}
+
+/* Writes SIZE bytes from the user buffers at C, which must be
+   locked into memory, to the console, and advances C past them. */
+static void
+console_iov_write (struct iov_cursor *c, size_t size)
+{
+  struct iovec iov[IOV_MAX];
+  int cnt;
+
+  for (cnt = 0; size > 0; cnt++)
+    {
+      size_t chunk = c->iov[c->idx].iov_len - c->ofs;
+
+      if (chunk > size)
+        chunk = size;
+      iov[cnt].iov_base = (uint8_t *) c->iov[c->idx].iov_base + c->ofs;
+      iov[cnt].iov_len = chunk;
+      size -= chunk;
+      iov_advance (c, chunk);
+    }
+  putbufv (iov, cnt);
+}
+
+/* Reads from the keyboard into the IOVCNT user buffers in IOV
+   until they are full.  Returns the number of bytes read, which
+   is less than asked for only if the process is killed
+   meanwhile. */
+static int
+keyboard_readv (const struct iovec *iov, int iovcnt)
+{
+  int bytes_read = 0;
+  int i;
+
+  for (i = 0; i < iovcnt; i++)
+    {
+      uint8_t *udst = iov[i].iov_base;
+      size_t j;
+
+      for (j = 0; j < iov[i].iov_len; j++)
+        {
+          uint8_t key;
+
+          if (!input_getc_interruptible (&key))
+            return bytes_read;
+          if (!put_user (udst + j, key))
+            {
+              process_kill (-1);
+              thread_exit ();
+            }
+          bytes_read++;
+        }
+    }
+  return bytes_read;
+}
+
+/* Reads (if WRITE is false) or writes (if it is true) the
+   IOVCNT user buffers described by kernel array IOV from or to
+   the file with the given HANDLE.  Starts at byte offset OFS, or
+   at the file position if OFS is negative, in which case the
+   position is advanced.  Returns the number of bytes transferred,
+   which is less than asked for only at end of file, or -1 on
+   error.  Pipes and the console take a negative OFS only. */
+static int
+vector_io (int handle, const struct iovec *iov, int iovcnt, off_t ofs,
+           bool write)
+{
+  struct file_descriptor *fd;
+  struct locked_pages lp;
+  struct iov_cursor c;
+  size_t total;
+  int done;
+  int i;
+
+  /* Add up the buffers. */
+  total = 0;
+  for (i = 0; i < iovcnt; i++)
+    {
+      if (iov[i].iov_len > INT_MAX - total)
+        return -1;
+      total += iov[i].iov_len;
+    }
+
+  fd = lookup_fd (handle);
+  if (fd->type != FD_FILE && ofs >= 0)
+    {
+      release_fd (fd);
+      return -1;
+    }
+
+  c.iov = iov;
+  c.cnt = iovcnt;
+  c.idx = 0;
+  c.ofs = 0;
+  iov_advance (&c, 0);
+
+  done = 0;
+  switch (fd->type)
+    {
+    case FD_PIPE_READ:
+      done = write ? -1 : pipe_readv (fd->pipe, iov, iovcnt);
+      break;
+
+    case FD_PIPE_WRITE:
+      done = write ? pipe_writev (fd->pipe, iov, iovcnt) : -1;
+      break;
+
+    case FD_CONSOLE:
+      if (!write)
+        {
+          done = keyboard_readv (iov, iovcnt);
+          break;
+        }
+      while ((size_t) done < total)
+        {
+          size_t size = lock_iov (&c, &lp, false);
+          console_iov_write (&c, size);
+          unlock_pages (&lp);
+          done += size;
+        }
+      break;
+
+    case FD_FILE:
+      while ((size_t) done < total)
+        {
+          size_t size = lock_iov (&c, &lp, !write);
+          size_t retval = file_iov_io (fd, &c, size, &ofs, write);
+          unlock_pages (&lp);
+          done += retval;
+          if (retval != size)
+            break;
+        }
+      break;
+    }
+
+  release_fd (fd);
+  return done;
+}
+
+/* Copies the IOVCNT buffer descriptors at UIOV into the kernel
+   and reads into or writes from them, for readv() or writev(). */
+static int
+vector_syscall (int handle, const struct iovec *uiov, int iovcnt, bool write)
+{
+  struct iovec iov[IOV_MAX];
+
+  if (iovcnt < 0 || iovcnt > IOV_MAX)
+    return -1;
+  copy_in (iov, uiov, sizeof *iov * iovcnt);
+  return vector_io (handle, iov, iovcnt, -1, write);
+}
+
+/* Readv system call. */
+static int
+sys_readv (int handle, const struct iovec *uiov, int iovcnt)
+{
+  return vector_syscall (handle, uiov, iovcnt, false);
+}
+
+/* Writev system call. */
+static int
+sys_writev (int handle, const struct iovec *uiov, int iovcnt)
+{
+  return vector_syscall (handle, uiov, iovcnt, true);
+}
+
+/* Pread system call. */
+static int
+sys_pread (int handle, void *udst, unsigned size, unsigned offset)
+{
+  struct iovec iov;
+
+  if ((off_t) offset < 0)
+    return -1;
+  iov.iov_base = udst;
+  iov.iov_len = size;
+  return vector_io (handle, &iov, 1, offset, false);
+}
+
+/* Pwrite system call. */
+static int
+sys_pwrite (int handle, const void *usrc, unsigned size, unsigned offset)
+{
+  struct iovec iov;
+
+  if ((off_t) offset < 0)
+    return -1;
+  iov.iov_base = (void *) usrc;
+  iov.iov_len = size;
+  return vector_io (handle, &iov, 1, offset, true);
+}
+
+/* Copyfile system call.  Copies SIZE bytes at OFFSET in the file
+   with SRC_HANDLE to the same offset in the file with DST_HANDLE,
+   without the data ever passing through user memory.  Returns
+   the number of bytes copied, or -1 on error. */
+static int
+sys_copyfile (int src_handle, int dst_handle, unsigned offset,
+              unsigned size)
+{
+  struct file_descriptor *src = lookup_file (src_handle);
+  struct file_descriptor *dst = lookup_file (dst_handle);
+  int bytes_copied = -1;
+
+  if (src != NULL && dst != NULL && (off_t) offset >= 0 && (off_t) size >= 0)
+    {
+      lock_acquire (&filesys_lock);
+      bytes_copied = file_copy_at (dst->file, src->file, size, offset);
+      lock_release (&filesys_lock);
+    }
+
+  if (src != NULL)
+    release_fd (src);
+  if (dst != NULL)
+    release_fd (dst);
+  return bytes_copied;
+}
+
+/* Returns true if system call CALL_NR may be queued in a system
+   call ring. */
+static bool
+ring_allowed (int call_nr)
+{
+  switch (call_nr)
+    {
+    case SYS_CREATE:
+    case SYS_REMOVE:
+    case SYS_OPEN:
+    case SYS_FILESIZE:
+    case SYS_READ:
+    case SYS_WRITE:
+    case SYS_SEEK:
+    case SYS_TELL:
+    case SYS_CLOSE:
+    case SYS_READV:
+    case SYS_WRITEV:
+      return true;
+
+    default:
+      return false;
+    }
+}
+
+/* Ring_enter system call.  Carries out the system calls queued
+   in URING's submission ring, in order, as long as there is room
+   for their results in its completion ring.  Returns the number
+   carried out. */
+static int
+sys_ring_enter (struct ring *uring)
+{
+  unsigned sq_head, sq_tail, cq_head, cq_tail;
+  int done;
+
+  copy_in (&sq_head, &uring->sq_head, sizeof sq_head);
+  copy_in (&sq_tail, &uring->sq_tail, sizeof sq_tail);
+  copy_in (&cq_head, &uring->cq_head, sizeof cq_head);
+  copy_in (&cq_tail, &uring->cq_tail, sizeof cq_tail);
+
+  for (done = 0; sq_head != sq_tail && cq_tail - cq_head < RING_ENTRIES;
+       done++)
+    {
+      struct ring_sqe sqe;
+      struct ring_cqe cqe;
+
+      copy_in (&sqe, &uring->sq[sq_head++ % RING_ENTRIES], sizeof sqe);
+      cqe.user_data = sqe.user_data;
+      if (ring_allowed (sqe.call_nr))
+        cqe.result = syscall_table[sqe.call_nr].func (sqe.args[0],
+                                                       sqe.args[1],
+                                                       sqe.args[2], 0);
+      else
+        cqe.result = -1;
+      copy_out (&uring->cq[cq_tail++ % RING_ENTRIES], &cqe, sizeof cqe);
+    }
+
+  copy_out (&uring->sq_head, &sq_head, sizeof sq_head);
+  copy_out (&uring->cq_tail, &cq_tail, sizeof cq_tail);
+  return done;
+}
+
+#ifdef VM
+/* Binds a mapping id to a region of memory and a file. */
+struct mapping
+  {
+    struct list_elem elem;      /* List element. */
+    int handle;                 /* Mapping id. */
+    struct file *file;          /* File. */
+    uint8_t *base;              /* Start of memory mapping. */
+    size_t page_cnt;            /* Number of pages mapped. */
+  };
+
+/* Returns the mapping associated with the given handle.
+   Terminates the process if HANDLE is not associated with a
+   memory mapping.  The caller must hold the process's
+   mappings_lock, which is released if the process is
+   terminated. */
+static struct mapping *
+lookup_mapping (int handle)
+{
+  struct thread *leader = thread_current ()->leader;
+  struct list_elem *e;
+
+  for (e = list_begin (&leader->mappings); e != list_end (&leader->mappings);
+       e = list_next (e))
+    {
+      struct mapping *m = list_entry (e, struct mapping, elem);
+      if (m->handle == handle)
+        return m;
+    }
+
+  lock_release (&leader->mappings_lock);
+  process_kill (-1);
   thread_exit ();
 }
+
+/* Removes mapping M from the virtual address space, writing back
+   any pages that have changed.  The caller must hold the
+   process's mappings_lock, unless the process has no other
+   threads. */
+static void
+unmap (struct mapping *m)
+{
+  size_t i;
+
+  list_remove (&m->elem);
+  for (i = 0; i < m->page_cnt; i++)
+    page_deallocate (m->base + PGSIZE * i);
+
+  lock_acquire (&filesys_lock);
+  file_close (m->file);
+  lock_release (&filesys_lock);
+  free (m);
+}
+
+/* Mmap system call.  Nothing is read here: each page of the
+   mapping is read from the file the first time it is touched,
+   and written back only if it was modified. */
+static int
+sys_mmap (int handle, void *addr)
+{
+  struct thread *leader = thread_current ()->leader;
+  struct file_descriptor *fd = lookup_file (handle);
+  struct mapping *m = malloc (sizeof *m);
+  size_t offset;
+  off_t length;
+  int mapping;
+
+  if (m == NULL || fd == NULL || addr == NULL || pg_ofs (addr) != 0)
+    {
+      if (fd != NULL)
+        release_fd (fd);
+      free (m);
+      return -1;
+    }
+
+  /* The whole mapping, from ADDR to ADDR + length - 1, must lie
+     in user memory. */
+  lock_acquire (&filesys_lock);
+  m->file = file_reopen (fd->file);
+  length = m->file != NULL ? file_length (m->file) : 0;
+  if (length > 0
+      && (!is_user_vaddr (addr)
+          || (size_t) length > (size_t) ((uint8_t *) PHYS_BASE
+                                         - (uint8_t *) addr)))
+    length = 0;
+  if (length == 0)
+    file_close (m->file);
+  lock_release (&filesys_lock);
+  release_fd (fd);
+  if (length == 0)
+    {
+      free (m);
+      return -1;
+    }
+
+  lock_acquire (&leader->mappings_lock);
+  m->handle = leader->next_handle++;
+  m->base = addr;
+  m->page_cnt = 0;
+  list_push_front (&leader->mappings, &m->elem);
+
+  offset = 0;
+  while (length > 0)
+    {
+      struct page *p = page_alloc ((uint8_t *) addr + offset, true);
+      if (p == NULL)
+        {
+          unmap (m);
+          lock_release (&leader->mappings_lock);
+          return -1;
+        }
+      p->type = PAGE_FILE;
+      p->write_back = true;
+      p->file = m->file;
+      p->file_offset = offset;
+      p->file_bytes = length >= PGSIZE ? PGSIZE : length;
+      offset += p->file_bytes;
+      length -= p->file_bytes;
+      m->page_cnt++;
+    }
+  mapping = m->handle;
+  lock_release (&leader->mappings_lock);
+
+  return mapping;
+}
+
+/* Munmap system call. */
+static int
+sys_munmap (int mapping)
+{
+  struct thread *leader = thread_current ()->leader;
+
+  lock_acquire (&leader->mappings_lock);
+  unmap (lookup_mapping (mapping));
+  lock_release (&leader->mappings_lock);
+  return 0;
+}
+
+/* Fork system call. */
+static int
+sys_fork (void)
+{
+  return process_fork ();
+}
+
+/* Thread_create system call.  The user library passes a
+   trampoline as ENTRY, which calls FUNC with AUX and then
+   thread_exit() with FUNC's return value. */
+static int
+sys_thread_create (void *entry, void *func, void *aux)
+{
+  return process_thread_create (entry, func, aux);
+}
+
+/* Thread_join system call. */
+static int
+sys_thread_join (tid_t tid)
+{
+  return process_thread_join (tid);
+}
+
+/* Thread_exit system call. */
+static int
+sys_thread_exit (int status)
+{
+  process_thread_exit (status);
+}
+#endif
+
+/* On process exit, close all open files and unmap all mappings.
+   Called by the last thread of the process, so nothing else is
+   using them, not even descriptors left in use by threads that
+   were killed in the middle of a system call. */
+void
+syscall_exit (void)
+{
+  struct thread *cur = thread_current ();
+  struct fd_table *t = cur->fd_table;
+#ifdef VM
+  struct list_elem *e, *next;
+#endif
+
+  if (t != NULL)
+    {
+      int handle;
+
+      for (handle = 0; handle < t->size; handle++)
+        if (t->fds[handle] != NULL)
+          free_fd (t->fds[handle]);
+      while (!list_empty (&t->closed))
+        free_fd (list_entry (list_pop_front (&t->closed),
+                             struct file_descriptor, elem));
+      free (t->fds);
+      free (t->used);
+      free (t);
+      cur->fd_table = NULL;
+    }
+
+#ifdef VM
+  for (e = list_begin (&cur->mappings); e != list_end (&cur->mappings);
+       e = next)
+    {
+      struct mapping *m = list_entry (e, struct mapping, elem);
+      next = list_next (e);
+      unmap (m);
+    }
+#endif
+}
+
+/* Gives the current thread, a new process started by PARENT
+   with exec() or fork(), a copy of each of PARENT's file
+   descriptors, with the same handle, referring to the same
+   object.  If EXEC is true, descriptors marked close-on-exec are
+   left out.  Unlike in Unix, a file's position in the parent and
+   the child move independently afterward.  If PARENT is not a
+   user process, gives the current thread the console as handles
+   STDIN_FILENO and STDOUT_FILENO instead.  PARENT must be blocked
+   for the duration, although other threads in its process may
+   keep running.
+   Returns true if successful, false on failure. */
+bool
+syscall_inherit (struct thread *parent, bool exec)
+{
+  struct fd_table *t, *pt;
+  bool success;
+  int handle;
+
+  t = thread_current ()->fd_table = fd_table_create ();
+  if (t == NULL)
+    return false;
+
+  if (parent->pagedir == NULL)
+    {
+      struct file_descriptor *in = new_fd (FD_CONSOLE);
+      struct file_descriptor *out = new_fd (FD_CONSOLE);
+      if (in == NULL || out == NULL)
+        {
+          free (in);
+          free (out);
+          return false;
+        }
+      install_fd_at (t, in, STDIN_FILENO);
+      install_fd_at (t, out, STDOUT_FILENO);
+      return true;
+    }
+
+  pt = parent->fd_table;
+  lock_acquire (&pt->lock);
+  if (!fd_table_grow (t, pt->size - 1))
+    {
+      lock_release (&pt->lock);
+      return false;
+    }
+
+  lock_acquire (&filesys_lock);
+  for (handle = 0; handle < pt->size; handle++)
+    {
+      struct file_descriptor *pfd = pt->fds[handle];
+      struct file_descriptor *fd;
+
+      if (pfd == NULL || (exec && pfd->cloexec))
+        continue;
+      fd = dup_fd (pfd);
+      if (fd == NULL)
+        break;
+      fd->cloexec = pfd->cloexec;
+      install_fd_at (t, fd, handle);
+    }
+  lock_release (&filesys_lock);
+  success = handle >= pt->size;
+  lock_release (&pt->lock);
+
+  return success;
+}
@@ -1,6 +1,13 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include <stdbool.h>
+
+struct thread;
+
 void syscall_init (void);
+void syscall_exit (void);
+bool syscall_inherit (struct thread *parent, bool exec);
+bool syscall_in_sysenter_entry (void (*eip) (void));
 
 #endif /* userprog/syscall.h */
@@ -104,3 +104,13 @@ tss_update (void)
   ASSERT (tss != NULL);
   tss->esp0 = (uint8_t *) thread_current () + PGSIZE;
 }
+
+/* Returns the address of the ring 0 stack pointer in the TSS,
+   which tss_update() keeps pointing to the end of the running
+   thread's stack. */
+void **
+tss_esp0 (void)
+{
+  ASSERT (tss != NULL);
+  return &tss->esp0;
+}
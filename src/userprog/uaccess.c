@@ -0,0 +1,96 @@
+#include "userprog/uaccess.h"
+#include "threads/interrupt.h"
+#include "threads/vaddr.h"
+
+/* Access to user memory.
+
+   Rather than checking that every page of a user buffer is
+   mapped before touching it, these functions just copy, and
+   leave bad addresses to the page fault handler.  The copy is a
+   single REP MOVSB, which the CPU stops at the faulting byte
+   with the bytes left to copy in ECX.  If the fault is not one
+   that the pager can resolve, page_fault() calls
+   uaccess_fixup(), which resumes execution just past the REP
+   MOVSB, so that the copy returns the number of bytes left
+   instead of taking down the kernel.
+
+   Only the range check below stands between a user pointer and
+   kernel memory, which the kernel can always access without
+   faulting. */
+
+size_t raw_copy (void *dst, const void *src, size_t size);
+extern const char raw_copy_insn[], raw_copy_done[];
+
+/* Copies SIZE bytes from SRC to DST.  Returns the number of
+   bytes not copied, nonzero only if a page fault stopped the
+   copy. */
+asm (".text\n"
+     "raw_copy:\n"
+     "        pushl %esi\n"
+     "        pushl %edi\n"
+     "        movl 12(%esp), %edi\n"
+     "        movl 16(%esp), %esi\n"
+     "        movl 20(%esp), %ecx\n"
+     "raw_copy_insn:\n"
+     "        rep movsb\n"
+     "raw_copy_done:\n"
+     "        movl %ecx, %eax\n"
+     "        popl %edi\n"
+     "        popl %esi\n"
+     "        ret\n");
+
+/* Returns true if the SIZE bytes at UADDR all lie in user
+   virtual memory. */
+static inline bool
+is_user_range (const void *uaddr, size_t size)
+{
+  uintptr_t start = (uintptr_t) uaddr;
+  return start + size >= start && start + size <= (uintptr_t) PHYS_BASE;
+}
+
+/* Copies SIZE bytes from user address USRC to kernel address
+   DST.  Returns true if successful, false if any of the user
+   bytes is not readable. */
+bool
+copy_from_user (void *dst, const void *usrc, size_t size)
+{
+  return is_user_range (usrc, size) && raw_copy (dst, usrc, size) == 0;
+}
+
+/* Copies SIZE bytes from kernel address SRC to user address
+   UDST.  Returns true if successful, false if any of the user
+   bytes is not writable. */
+bool
+copy_to_user (void *udst, const void *src, size_t size)
+{
+  return is_user_range (udst, size) && raw_copy (udst, src, size) == 0;
+}
+
+/* Reads a byte at user address USRC into *DST.  Returns true if
+   successful, false if USRC is not readable. */
+bool
+get_user (uint8_t *dst, const uint8_t *usrc)
+{
+  return copy_from_user (dst, usrc, 1);
+}
+
+/* Writes BYTE to user address UDST.  Returns true if
+   successful, false if UDST is not writable. */
+bool
+put_user (uint8_t *udst, uint8_t byte)
+{
+  return copy_to_user (udst, &byte, 1);
+}
+
+/* Called by the page fault handler for a fault in the kernel
+   that it could not resolve.  If the fault is in one of the
+   copies above, arranges for the copy to return failure and
+   returns true.  Otherwise, returns false. */
+bool
+uaccess_fixup (struct intr_frame *f)
+{
+  if ((const char *) f->eip != raw_copy_insn)
+    return false;
+  f->eip = (void (*) (void)) raw_copy_done;
+  return true;
+}
@@ -0,0 +1,82 @@
+#include "userprog/vdso.h"
+#include <debug.h>
+#include <vdso.h>
+#include "userprog/pagedir.h"
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+
+/* Gives the current process a vDSO page, mapped read-only at
+   VDSO_BASE in its page directory.  See lib/vdso.h.
+   Returns true if successful, false if memory is short. */
+bool
+vdso_map (void)
+{
+  struct thread *t = thread_current ();
+  struct vdso_data *vdso;
+
+  ASSERT (t->vdso == NULL);
+  ASSERT (pg_ofs (VDSO_BASE) == 0);
+
+  vdso = palloc_get_page (PAL_ZERO);
+  if (vdso == NULL)
+    return false;
+  if (!pagedir_set_page (t->pagedir, VDSO_BASE, vdso, false))
+    {
+      palloc_free_page (vdso);
+      return false;
+    }
+  vdso->timer_freq = TIMER_FREQ;
+
+  t->vdso = vdso;
+  vdso_update (false);
+  return true;
+}
+
+/* Removes the current process's vDSO page, if it has one. */
+void
+vdso_unmap (void)
+{
+  struct thread *t = thread_current ();
+  struct vdso_data *vdso;
+  enum intr_level old_level;
+
+  /* Keep the timer from updating the page as we free it. */
+  old_level = intr_disable ();
+  vdso = t->vdso;
+  t->vdso = NULL;
+  intr_set_level (old_level);
+
+  if (vdso != NULL)
+    {
+      pagedir_clear_page (t->pagedir, VDSO_BASE);
+      palloc_free_page (vdso);
+    }
+}
+
+/* Brings the current process's vDSO page up to date, first
+   charging it with another tick of CPU time if TICK is true.
+   Called at each timer tick and each time a process is
+   scheduled. */
+void
+vdso_update (bool tick)
+{
+  enum intr_level old_level = intr_disable ();
+  struct vdso_data *vdso = thread_current ()->vdso;
+
+  if (vdso != NULL)
+    {
+      vdso->seq++;
+      barrier ();
+      vdso->ticks = timer_ticks ();
+      if (tick)
+        vdso->cpu_ticks++;
+      vdso->load_avg = thread_get_load_avg ();
+      barrier ();
+      vdso->seq++;
+    }
+  intr_set_level (old_level);
+}
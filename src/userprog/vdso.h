@@ -0,0 +1,10 @@
+#ifndef USERPROG_VDSO_H
+#define USERPROG_VDSO_H
+
+#include <stdbool.h>
+
+bool vdso_map (void);
+void vdso_unmap (void);
+void vdso_update (bool tick);
+
+#endif /* userprog/vdso.h */
@@ -0,0 +1,538 @@
+#include "vm/frame.h"
+#include <debug.h>
+#include <stdio.h>
+#include "vm/page.h"
+#include "devices/timer.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "filesys/inode.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/loader.h"
+#include "threads/thread.h"
+
+/* Every frame in the user pool, claimed from palloc at boot. */
+static struct frame *frames;
+static size_t frame_cnt;
+
+/* Serializes eviction. */
+static struct lock scan_lock;
+
+/* Number of frames not in use by any page, including those kept
+   only by the text cache.  Changed with interrupts off. */
+static size_t free_cnt;
+
+/* The page-out daemon evicts pages in the background whenever
+   fewer than LOW_WATER frames are free, until HIGH_WATER frames
+   are free, so that a fault usually finds a free frame without
+   waiting for a page to be written out. */
+static size_t low_water, high_water;
+static struct semaphore pageout_sema;   /* Up'd to wake the daemon. */
+static bool pageout_asleep;             /* Daemon waiting on it? */
+
+/* Clock hand: the next frame to consider for eviction. */
+static size_t hand;
+
+/* Most dirty pages written to swap by one eviction. */
+#define EVICT_BATCH 8
+
+/* Frames holding read-only pages of files, keyed by inode and
+   offset, so that processes running the same executable share
+   its text.  Lookups and changes take text_lock; changes also
+   require the frame's own lock. */
+static struct hash text_cache;
+static struct lock text_lock;
+
+static struct frame *find_free_frame (struct page *);
+static struct frame *clock_evict (bool take_free);
+static bool evict (size_t idx);
+static void wake_pageout (void);
+static thread_func pageout_thread NO_RETURN;
+static void uncache (struct frame *);
+static hash_hash_func text_hash;
+static hash_less_func text_less;
+
+/* Initializes the frame table by taking every page in the user
+   pool away from palloc. */
+void
+frame_init (void)
+{
+  void *base;
+
+  lock_init (&scan_lock);
+  lock_init (&text_lock);
+  sema_init (&pageout_sema, 0);
+  hash_init (&text_cache, text_hash, text_less, NULL);
+
+  frames = malloc (sizeof *frames * init_ram_pages);
+  if (frames == NULL)
+    PANIC ("out of memory allocating page frames");
+
+  while ((base = palloc_get_page (PAL_USER)) != NULL)
+    {
+      struct frame *f = &frames[frame_cnt++];
+      lock_init (&f->lock);
+      f->base = base;
+      list_init (&f->pages);
+      f->ref_cnt = 0;
+      f->dirty = false;
+      f->text_inode = NULL;
+    }
+  free_cnt = frame_cnt;
+
+  /* About 3% and 6% of user memory. */
+  low_water = frame_cnt / 32 + 1;
+  high_water = low_water * 2;
+}
+
+/* Starts the page-out daemon.  Must be called after
+   thread_start() and swap_init(). */
+void
+frame_init_pageout (void)
+{
+  thread_create ("pageout", PRI_DEFAULT, pageout_thread, NULL);
+}
+
+/* Finds a free frame, assigns it to PAGE, and returns it locked.
+   Returns a null pointer if no frame is free.  Free frames that
+   are still in the text cache are left for the clock to reclaim. */
+static struct frame *
+find_free_frame (struct page *page)
+{
+  size_t i;
+
+  for (i = 0; i < frame_cnt; i++)
+    {
+      struct frame *f = &frames[i];
+      if (!lock_try_acquire (&f->lock))
+        continue;
+      if (f->ref_cnt == 0 && f->text_inode == NULL)
+        {
+          frame_attach (f, page);
+          return f;
+        }
+      lock_release (&f->lock);
+    }
+  return NULL;
+}
+
+/* Evicts the pages in frames[IDX], which must be locked by the
+   caller.  If they are dirty and bound for swap, the cold dirty
+   frames right after it go to swap with it, in one write to
+   consecutive slots, and become free.  That turns a run of
+   evictions into a single disk command and leaves spare frames
+   behind for the next faults, and pages that were faulted in
+   together tend to come back out together.
+   Returns true if successful, false on failure. */
+static bool
+evict (size_t idx)
+{
+  struct frame *run[EVICT_BATCH];
+  size_t cnt = 1;
+  size_t i;
+
+  run[0] = &frames[idx];
+  if (!page_is_dirty (run[0]) || !page_swappable (run[0]))
+    return page_out (run[0]);
+
+  while (cnt < EVICT_BATCH && idx + cnt < frame_cnt)
+    {
+      struct frame *f = &frames[idx + cnt];
+      if (!lock_try_acquire (&f->lock))
+        break;
+      if (f->ref_cnt == 0
+          || !page_swappable (f)
+          || page_accessed_recently (f)
+          || !page_is_dirty (f))
+        {
+          lock_release (&f->lock);
+          break;
+        }
+      run[cnt++] = f;
+    }
+
+  if (cnt > 1 && page_out_run (run, cnt))
+    {
+      for (i = 1; i < cnt; i++)
+        frame_unlock (run[i]);
+      return true;
+    }
+
+  /* Fall back to evicting the one frame. */
+  for (i = 1; i < cnt; i++)
+    frame_unlock (run[i]);
+  return page_out (run[0]);
+}
+
+/* Allocates a frame for PAGE only if one is free, never evicting
+   another page for it, and returns it locked.
+   Returns a null pointer if no frame is free. */
+struct frame *
+frame_alloc_free_and_lock (struct page *page)
+{
+  struct frame *f = find_free_frame (page);
+  wake_pageout ();
+  return f;
+}
+
+/* Finds a frame to evict with the second-chance clock algorithm,
+   evicts it, and returns it, free and locked.  If TAKE_FREE is
+   true, a free frame kept only by the text cache is taken as
+   soon as the hand reaches it; otherwise, free frames are
+   skipped.  Returns a null pointer if nothing can be evicted.
+   The caller must hold scan_lock. */
+static struct frame *
+clock_evict (bool take_free)
+{
+  size_t i;
+
+  /* A frame whose page has been accessed since the hand last
+     passed it gets its accessed bit cleared and is skipped.  For
+     the first two sweeps, which is enough to clear every accessed
+     bit, we also skip dirty pages, because clean pages can be
+     dropped without writing them anywhere.  Frames locked by
+     their owners, e.g. pinned for kernel I/O, are always
+     skipped. */
+  for (i = 0; i < frame_cnt * 3; i++)
+    {
+      size_t idx = hand;
+      bool clean_only = i < frame_cnt * 2;
+      struct frame *f = &frames[idx];
+
+      if (++hand >= frame_cnt)
+        hand = 0;
+
+      if (!lock_try_acquire (&f->lock))
+        continue;
+
+      if (f->ref_cnt == 0)
+        {
+          if (take_free)
+            {
+              uncache (f);
+              return f;
+            }
+          lock_release (&f->lock);
+          continue;
+        }
+
+      if (page_accessed_recently (f)
+          || (clean_only && page_is_dirty (f))
+          || !evict (idx))
+        {
+          lock_release (&f->lock);
+          continue;
+        }
+      return f;
+    }
+  return NULL;
+}
+
+/* Tries to allocate and lock a frame for PAGE.
+   Returns the frame if successful, a null pointer on failure. */
+static struct frame *
+try_frame_alloc_and_lock (struct page *page)
+{
+  struct frame *f;
+
+  /* Usually the page-out daemon has left a free frame. */
+  f = find_free_frame (page);
+  if (f == NULL)
+    {
+      /* No free frame.  Evict one ourselves, unless the daemon
+         freed some while we waited for scan_lock. */
+      lock_acquire (&scan_lock);
+      f = find_free_frame (page);
+      if (f == NULL)
+        {
+          f = clock_evict (true);
+          if (f != NULL)
+            frame_attach (f, page);
+        }
+      lock_release (&scan_lock);
+    }
+
+  wake_pageout ();
+  return f;
+}
+
+/* Tries really hard to allocate and lock a frame for PAGE.
+   Returns the frame if successful, a null pointer on failure. */
+struct frame *
+frame_alloc_and_lock (struct page *page)
+{
+  size_t try;
+
+  for (try = 0; try < 3; try++)
+    {
+      struct frame *f = try_frame_alloc_and_lock (page);
+      if (f != NULL)
+        {
+          ASSERT (lock_held_by_current_thread (&f->lock));
+          return f;
+        }
+
+      /* Every frame is locked, or swap is full.  Give the
+         processes holding them a chance to finish. */
+      timer_msleep (1000);
+    }
+
+  return NULL;
+}
+
+/* Locks P's frame into memory, if it has one.
+   Upon return, p->frame will not change until P is unlocked. */
+void
+frame_lock (struct page *p)
+{
+  /* A frame can be asynchronously removed, but never inserted. */
+  struct frame *f = p->frame;
+  if (f != NULL)
+    {
+      lock_acquire (&f->lock);
+      if (f != p->frame)
+        {
+          lock_release (&f->lock);
+          ASSERT (p->frame == NULL);
+        }
+    }
+}
+
+/* Adds page P to the pages sharing frame F, which must be
+   locked. */
+void
+frame_attach (struct frame *f, struct page *p)
+{
+  enum intr_level old_level;
+
+  ASSERT (lock_held_by_current_thread (&f->lock));
+
+  list_push_back (&f->pages, &p->frame_elem);
+  if (f->ref_cnt++ == 0)
+    {
+      old_level = intr_disable ();
+      free_cnt--;
+      intr_set_level (old_level);
+    }
+  p->frame = f;
+}
+
+/* Removes page P from the pages sharing frame F, which must be
+   locked.  F is free once no pages are left. */
+void
+frame_detach (struct frame *f, struct page *p)
+{
+  enum intr_level old_level;
+
+  ASSERT (lock_held_by_current_thread (&f->lock));
+  ASSERT (p->frame == f);
+
+  list_remove (&p->frame_elem);
+  if (--f->ref_cnt == 0)
+    {
+      old_level = intr_disable ();
+      free_cnt++;
+      intr_set_level (old_level);
+    }
+  p->frame = NULL;
+}
+
+/* Detaches all of the pages that share frame F, leaving it free
+   for use by another page.  F must be locked for use by the
+   current process, and stays locked.
+   Any data in F is lost. */
+void
+frame_free (struct frame *f)
+{
+  ASSERT (lock_held_by_current_thread (&f->lock));
+
+  while (f->ref_cnt > 0)
+    frame_detach (f, list_entry (list_front (&f->pages),
+                                 struct page, frame_elem));
+  f->dirty = false;
+  uncache (f);
+}
+
+/* Unlocks frame F, allowing it to be evicted.
+   F must be locked for use by the current process. */
+void
+frame_unlock (struct frame *f)
+{
+  ASSERT (lock_held_by_current_thread (&f->lock));
+  lock_release (&f->lock);
+}
+
+/* Looks in the text cache for a frame holding the contents of
+   page P, which must be a read-only page of a file.  If there is
+   one, adds P to it and returns it locked.  Otherwise, returns a
+   null pointer. */
+struct frame *
+frame_find_text_and_lock (struct page *p)
+{
+  struct frame key;
+  struct frame *f;
+  struct hash_elem *e;
+
+  ASSERT (p->type == PAGE_FILE && !p->writable);
+
+  key.text_inode = file_get_inode (p->file);
+  key.text_ofs = p->file_offset;
+  key.text_bytes = p->file_bytes;
+
+  lock_acquire (&text_lock);
+  e = hash_find (&text_cache, &key.text_elem);
+  f = e != NULL ? hash_entry (e, struct frame, text_elem) : NULL;
+  lock_release (&text_lock);
+  if (f == NULL)
+    return NULL;
+
+  /* The frame may have been reclaimed, and even reused, before we
+     got its lock. */
+  lock_acquire (&f->lock);
+  if (f->text_inode != key.text_inode
+      || f->text_ofs != key.text_ofs
+      || f->text_bytes != key.text_bytes)
+    {
+      lock_release (&f->lock);
+      return NULL;
+    }
+
+  /* Drop it if the file has been written since.  That can only
+     happen while no process is running the executable, since
+     running one denies writes to it. */
+  if (f->text_version != inode_version (key.text_inode))
+    {
+      uncache (f);
+      lock_release (&f->lock);
+      return NULL;
+    }
+
+  frame_attach (f, p);
+  return f;
+}
+
+/* Adds frame F, which must be locked and just filled in from
+   page P, a read-only page of a file, to the text cache.  Does
+   nothing if another frame already holds the same contents. */
+void
+frame_add_text (struct frame *f, struct page *p)
+{
+  struct inode *inode = file_get_inode (p->file);
+  bool added;
+
+  ASSERT (lock_held_by_current_thread (&f->lock));
+  ASSERT (f->text_inode == NULL);
+
+  f->text_ofs = p->file_offset;
+  f->text_bytes = p->file_bytes;
+  f->text_version = inode_version (inode);
+
+  lock_acquire (&text_lock);
+  f->text_inode = inode;
+  added = hash_insert (&text_cache, &f->text_elem) == NULL;
+  if (!added)
+    f->text_inode = NULL;
+  lock_release (&text_lock);
+
+  /* Keep the inode from going away, and its memory from being
+     reused for another inode, while the cache refers to it. */
+  if (added)
+    {
+      lock_acquire (&filesys_lock);
+      inode_reopen (inode);
+      lock_release (&filesys_lock);
+    }
+}
+
+/* Removes frame F, which must be locked, from the text cache, if
+   it is there. */
+static void
+uncache (struct frame *f)
+{
+  struct inode *inode = f->text_inode;
+
+  ASSERT (lock_held_by_current_thread (&f->lock));
+
+  if (inode != NULL)
+    {
+      lock_acquire (&text_lock);
+      hash_delete (&text_cache, &f->text_elem);
+      f->text_inode = NULL;
+      lock_release (&text_lock);
+
+      lock_acquire (&filesys_lock);
+      inode_close (inode);
+      lock_release (&filesys_lock);
+    }
+}
+
+/* Returns a hash value for the text cache frame that E refers
+   to. */
+static unsigned
+text_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct frame *f = hash_entry (e, struct frame, text_elem);
+  return hash_bytes (&f->text_inode, sizeof f->text_inode)
+         ^ hash_int (f->text_ofs);
+}
+
+/* Returns true if text cache frame A precedes frame B. */
+static bool
+text_less (const struct hash_elem *a_, const struct hash_elem *b_,
+           void *aux UNUSED)
+{
+  const struct frame *a = hash_entry (a_, struct frame, text_elem);
+  const struct frame *b = hash_entry (b_, struct frame, text_elem);
+
+  if (a->text_inode != b->text_inode)
+    return a->text_inode < b->text_inode;
+  else if (a->text_ofs != b->text_ofs)
+    return a->text_ofs < b->text_ofs;
+  else
+    return a->text_bytes < b->text_bytes;
+}
+
+/* Wakes the page-out daemon if too few frames are free. */
+static void
+wake_pageout (void)
+{
+  enum intr_level old_level = intr_disable ();
+  if (pageout_asleep && free_cnt < low_water)
+    {
+      pageout_asleep = false;
+      sema_up (&pageout_sema);
+    }
+  intr_set_level (old_level);
+}
+
+/* Page-out daemon.  Evicts pages, in the same order as a
+   faulting thread would, until HIGH_WATER frames are free, then
+   sleeps until fewer than LOW_WATER are.  Dirty pages go out to
+   swap in runs, as with any eviction, so most of the disk writes
+   happen here rather than in a fault. */
+static void
+pageout_thread (void *aux UNUSED)
+{
+  for (;;)
+    {
+      enum intr_level old_level;
+
+      while (free_cnt < high_water)
+        {
+          struct frame *f;
+
+          lock_acquire (&scan_lock);
+          f = clock_evict (false);
+          lock_release (&scan_lock);
+          if (f == NULL)
+            break;
+          frame_unlock (f);
+        }
+
+      old_level = intr_disable ();
+      pageout_asleep = true;
+      sema_down (&pageout_sema);
+      intr_set_level (old_level);
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef VM_FRAME_H
+#define VM_FRAME_H
+
+#include <hash.h>
+#include <list.h>
+#include <stdbool.h>
+#include "filesys/off_t.h"
+#include "threads/synch.h"
+
+struct page;
+
+/* A physical frame of user memory.
+
+   After fork(), the same frame can hold a page of the parent and
+   the corresponding page of the child.  Each such page appears
+   in PAGES.  While more than one page shares a frame, all of
+   them are mapped read-only, and the first write to any of them
+   copies the frame. */
+struct frame
+  {
+    struct lock lock;           /* Prevent simultaneous access. */
+    void *base;                 /* Kernel virtual base address. */
+    struct list pages;          /* Pages sharing this frame. */
+    int ref_cnt;                /* Number of PAGES; 0 if free. */
+    bool dirty;                 /* Written through a page now gone. */
+
+    /* Text cache.  While TEXT_INODE is nonnull, the frame holds
+       TEXT_BYTES bytes read from offset TEXT_OFS in TEXT_INODE,
+       zero-padded, as of version TEXT_VERSION of the inode, and
+       any process faulting in a read-only page of the same bytes
+       maps this frame.  Such a frame stays cached after its last
+       page goes away, until it is reclaimed. */
+    struct hash_elem text_elem; /* `text_cache' hash element. */
+    struct inode *text_inode;   /* Cached inode, or NULL. */
+    off_t text_ofs;             /* Offset in TEXT_INODE. */
+    off_t text_bytes;           /* Bytes read from TEXT_INODE. */
+    unsigned text_version;      /* inode_version() when read. */
+  };
+
+void frame_init (void);
+void frame_init_pageout (void);
+
+struct frame *frame_alloc_and_lock (struct page *);
+struct frame *frame_alloc_free_and_lock (struct page *);
+void frame_lock (struct page *);
+
+struct frame *frame_find_text_and_lock (struct page *);
+void frame_add_text (struct frame *, struct page *);
+
+void frame_attach (struct frame *, struct page *);
+void frame_detach (struct frame *, struct page *);
+void frame_free (struct frame *);
+void frame_unlock (struct frame *);
+
+#endif /* vm/frame.h */
@@ -0,0 +1,824 @@
+#include "vm/page.h"
+#include <debug.h>
+#include <string.h>
+#include <vdso.h>
+#include "vm/frame.h"
+#include "vm/swap.h"
+#include "filesys/file.h"
+#include "filesys/filesys.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+
+static struct page *insert_page (void *vaddr, bool writable);
+static struct page *page_for_addr (const void *address);
+static struct page *page_for_addr_or_stack (const void *address);
+static bool fault_in (void *fault_addr);
+static bool do_page_in (struct page *, bool may_evict);
+static bool install_frame (struct page *, bool keep_dirty);
+static void destroy_page (struct hash_elem *, void *aux);
+static void fault_around (struct page *);
+static void read_ahead (struct page *);
+static void write_back (struct page *);
+static bool unshare (struct page *);
+static bool map_read_only (struct page *);
+static bool is_text (const struct page *);
+
+/* Most pages the user stack may grow to: 8 MB by default.
+   Controlled by kernel command-line option "-stack". */
+size_t stack_max_pages = 2048;
+
+/* A fault also maps the resident pages in the aligned block of
+   FAULT_AROUND pages that contains the faulting page. */
+#define FAULT_AROUND 8
+
+/* Most pages brought in by one fault in a sequential run,
+   counting the faulting page itself. */
+#define READ_AHEAD_MAX 32
+
+/* Creates an empty supplemental page table for the current
+   thread.  Returns true if successful, false on memory
+   allocation failure. */
+bool
+page_table_create (void)
+{
+  struct thread *t = thread_current ();
+
+  ASSERT (t->pages == NULL);
+  t->pages = malloc (sizeof *t->pages);
+  if (t->pages == NULL)
+    return false;
+  hash_init (&t->pages->pages, page_hash, page_less, NULL);
+  lock_init (&t->pages->lock);
+  lock_init (&t->pages->fault_lock);
+  return true;
+}
+
+/* Destroys the current thread's supplemental page table,
+   releasing the frames of all its resident pages.  Afterward
+   the page directory maps no user pages.  The process must have
+   no other threads left. */
+void
+page_table_destroy (void)
+{
+  struct page_table *pt = thread_current ()->pages;
+  if (pt != NULL)
+    {
+      thread_current ()->pages = NULL;
+      hash_destroy (&pt->pages, destroy_page);
+      free (pt);
+    }
+}
+
+/* Destroys the page containing hash element E, which belongs
+   to the current thread. */
+static void
+destroy_page (struct hash_elem *e, void *aux UNUSED)
+{
+  struct page *p = hash_entry (e, struct page, hash_elem);
+  frame_lock (p);
+  if (p->frame != NULL)
+    {
+      struct frame *f = p->frame;
+      pagedir_clear_page (p->thread->pagedir, p->addr);
+      if (p->write_back && pagedir_is_dirty (p->thread->pagedir, p->addr))
+        write_back (p);
+      frame_detach (f, p);
+      frame_unlock (f);
+    }
+  swap_free (p);
+  free (p);
+}
+
+/* Adds a mapping for user virtual address VADDR to the current
+   thread's page table.  The page starts out as PAGE_ZERO; the
+   caller may change its type before it is first touched.
+   Fails if VADDR is already mapped or if memory allocation
+   fails.  Returns the new page if successful, otherwise a null
+   pointer. */
+struct page *
+page_alloc (void *vaddr, bool writable)
+{
+  struct page_table *pt = thread_current ()->pages;
+  struct page *p;
+
+  lock_acquire (&pt->fault_lock);
+  p = insert_page (vaddr, writable);
+  lock_release (&pt->fault_lock);
+  return p;
+}
+
+/* Does the work of page_alloc().  The caller must hold the page
+   table's fault_lock. */
+static struct page *
+insert_page (void *vaddr, bool writable)
+{
+  struct thread *t = thread_current ();
+  struct page_table *pt = t->pages;
+  struct page *p;
+  struct hash_elem *old;
+
+  ASSERT (lock_held_by_current_thread (&pt->fault_lock));
+
+  /* The vDSO page is mapped directly in the page directory, and
+     kernel addresses never fault in. */
+  if (pg_round_down (vaddr) == VDSO_BASE || !is_user_vaddr (vaddr))
+    return NULL;
+
+  p = malloc (sizeof *p);
+  if (p != NULL)
+    {
+      p->addr = pg_round_down (vaddr);
+      p->writable = writable;
+      p->thread = t->leader;
+      p->frame = NULL;
+      p->type = PAGE_ZERO;
+      p->sector = (block_sector_t) -1;
+      p->file = NULL;
+      p->file_offset = 0;
+      p->file_bytes = 0;
+      p->write_back = false;
+
+      lock_acquire (&pt->lock);
+      old = hash_insert (&pt->pages, &p->hash_elem);
+      lock_release (&pt->lock);
+      if (old != NULL)
+        {
+          /* Already mapped. */
+          free (p);
+          p = NULL;
+        }
+    }
+  return p;
+}
+
+/* Evicts the page containing address VADDR and removes it from
+   the current thread's page table. */
+void
+page_deallocate (void *vaddr)
+{
+  struct page_table *pt = thread_current ()->pages;
+  struct page *p;
+
+  lock_acquire (&pt->fault_lock);
+  p = page_for_addr (vaddr);
+  ASSERT (p != NULL);
+  lock_acquire (&pt->lock);
+  hash_delete (&pt->pages, &p->hash_elem);
+  lock_release (&pt->lock);
+  destroy_page (&p->hash_elem, NULL);
+  lock_release (&pt->fault_lock);
+}
+
+/* Evicts and removes whichever pages exist among the PAGE_CNT
+   pages starting at VADDR from the current thread's page table,
+   as when a thread exits and gives up its stack. */
+void
+page_deallocate_range (void *vaddr, size_t page_cnt)
+{
+  struct page_table *pt = thread_current ()->pages;
+  uint8_t *addr = pg_round_down (vaddr);
+  size_t i;
+
+  lock_acquire (&pt->fault_lock);
+  for (i = 0; i < page_cnt; i++)
+    {
+      struct page *p = page_for_addr (addr + i * PGSIZE);
+      if (p != NULL)
+        {
+          lock_acquire (&pt->lock);
+          hash_delete (&pt->pages, &p->hash_elem);
+          lock_release (&pt->lock);
+          destroy_page (&p->hash_elem, NULL);
+        }
+    }
+  lock_release (&pt->fault_lock);
+}
+
+/* Returns the page containing the given virtual ADDRESS in the
+   current thread's page table, or a null pointer if no such
+   page exists. */
+static struct page *
+page_for_addr (const void *address)
+{
+  struct page_table *pt = thread_current ()->pages;
+  struct page p;
+  struct hash_elem *e;
+
+  if (pt == NULL || !is_user_vaddr (address))
+    return NULL;
+
+  p.addr = (void *) pg_round_down (address);
+  lock_acquire (&pt->lock);
+  e = hash_find (&pt->pages, &p.hash_elem);
+  lock_release (&pt->lock);
+  return e != NULL ? hash_entry (e, struct page, hash_elem) : NULL;
+}
+
+/* Returns the page containing ADDRESS, as page_for_addr() does.
+   If there is none, but ADDRESS looks like an access to the
+   user stack, grows the stack with a zero page to cover it.
+   That is the case if ADDRESS is no more than 32 bytes below the
+   thread's stack pointer, the most that PUSHA reaches below it
+   before updating it, and within stack_max_pages below the top
+   of the thread's stack.  The caller must hold the page table's
+   fault_lock. */
+static struct page *
+page_for_addr_or_stack (const void *address)
+{
+  struct thread *t = thread_current ();
+  struct page *p = page_for_addr (address);
+  const uint8_t *esp = t->user_esp;
+
+  if (p == NULL && is_user_vaddr (address)
+      && (const uint8_t *) address >= esp - 32
+      && address < t->user_stack
+      && pg_no (t->user_stack) - pg_no (address) <= stack_max_pages)
+    p = insert_page ((void *) address, true);
+  return p;
+}
+
+/* Locks a frame for page P and fills it with P's contents.  If
+   MAY_EVICT is false, only a free frame will do.
+   Returns true if successful, false on failure. */
+static bool
+do_page_in (struct page *p, bool may_evict)
+{
+  struct frame *f;
+
+  /* Another process running the same executable may already
+     have this page in memory. */
+  if (is_text (p))
+    {
+      f = frame_find_text_and_lock (p);
+      if (f != NULL)
+        return true;
+    }
+
+  /* Get a frame for the page. */
+  f = may_evict ? frame_alloc_and_lock (p) : frame_alloc_free_and_lock (p);
+  if (f == NULL)
+    return false;
+
+  /* Copy data into the frame. */
+  switch (p->type)
+    {
+    case PAGE_FILE:
+      {
+        off_t read_bytes;
+
+        lock_acquire (&filesys_lock);
+        read_bytes = file_read_at (p->file, p->frame->base,
+                                   p->file_bytes, p->file_offset);
+        lock_release (&filesys_lock);
+        if (read_bytes != p->file_bytes)
+          {
+            frame_free (f);
+            frame_unlock (f);
+            return false;
+          }
+        memset (p->frame->base + read_bytes, 0, PGSIZE - read_bytes);
+        if (is_text (p))
+          frame_add_text (f, p);
+      }
+      break;
+
+    case PAGE_ZERO:
+      memset (p->frame->base, 0, PGSIZE);
+      break;
+
+    case PAGE_SWAP:
+      swap_in (p);
+      break;
+    }
+
+  return true;
+}
+
+/* Maps page P's locked frame into its owner's page directory,
+   read-only if the frame is shared.
+   If KEEP_DIRTY is true, P stayed resident while unmapped, by an
+   eviction that gave up, so the frame may hold data written
+   through the old mapping: carry its dirty bit over.
+   Returns true if successful, false on memory allocation
+   failure. */
+static bool
+install_frame (struct page *p, bool keep_dirty)
+{
+  uint32_t *pd = p->thread->pagedir;
+  bool dirty = keep_dirty && pagedir_is_dirty (pd, p->addr);
+  bool writable = p->writable && p->frame->ref_cnt == 1;
+
+  if (!pagedir_set_page (pd, p->addr, p->frame->base, writable))
+    return false;
+  if (dirty)
+    pagedir_set_dirty (pd, p->addr, true);
+  return true;
+}
+
+/* Faults in the page containing FAULT_ADDR.
+   Returns true if successful, false on failure, in which case
+   the fault is not one the pager can resolve. */
+bool
+page_in (void *fault_addr)
+{
+  struct page_table *pt = thread_current ()->pages;
+  bool success;
+
+  if (pt == NULL)
+    return false;
+  lock_acquire (&pt->fault_lock);
+  success = fault_in (fault_addr);
+  lock_release (&pt->fault_lock);
+  return success;
+}
+
+/* Does the work of page_in().  The caller must hold the page
+   table's fault_lock. */
+static bool
+fault_in (void *fault_addr)
+{
+  struct page *p;
+  bool resident;
+  bool success;
+
+  p = page_for_addr_or_stack (fault_addr);
+  if (p == NULL)
+    return false;
+
+  frame_lock (p);
+  resident = p->frame != NULL;
+  if (!resident)
+    {
+      if (!do_page_in (p, true))
+        return false;
+    }
+  ASSERT (lock_held_by_current_thread (&p->frame->lock));
+
+  /* Install frame into page table. */
+  success = install_frame (p, resident);
+
+  /* Release frame. */
+  frame_unlock (p->frame);
+
+  if (success)
+    {
+      fault_around (p);
+      if (!resident)
+        read_ahead (p);
+    }
+
+  return success;
+}
+
+/* Maps the pages around page P, which was just faulted in, that
+   are already in memory but not mapped, as after fork() or when
+   another process is running the same executable, so that each
+   takes no fault of its own. */
+static void
+fault_around (struct page *p)
+{
+  uint8_t *start = (uint8_t *) ((uintptr_t) p->addr
+                                & ~(FAULT_AROUND * PGSIZE - 1));
+  int i;
+
+  for (i = 0; i < FAULT_AROUND; i++)
+    {
+      struct page *q = page_for_addr (start + i * PGSIZE);
+      bool resident;
+
+      if (q == NULL || q == p)
+        continue;
+
+      frame_lock (q);
+      resident = q->frame != NULL;
+      if (!resident && (!is_text (q) || frame_find_text_and_lock (q) == NULL))
+        continue;
+      if (pagedir_get_page (q->thread->pagedir, q->addr) == NULL)
+        install_frame (q, resident);
+      frame_unlock (q->frame);
+    }
+}
+
+/* Called after faulting in page P from its file, swap, or as
+   zeros.  If that continues a sequential run of faults, brings
+   in the pages that follow P as well, as long as there are free
+   frames to hold them, so that a process walking through its
+   memory takes one fault per window of pages.  The window
+   doubles with each fault in a run, up to READ_AHEAD_MAX pages,
+   and drops back to just the faulting page when the run is
+   broken. */
+static void
+read_ahead (struct page *p)
+{
+  struct thread *t = thread_current ();
+  uint8_t *addr = p->addr;
+  int i;
+
+  if (addr != t->ra_next)
+    t->ra_window = 1;
+  else if (t->ra_window < READ_AHEAD_MAX / 2)
+    t->ra_window = t->ra_window < 1 ? 2 : t->ra_window * 2;
+  else
+    t->ra_window = READ_AHEAD_MAX;
+
+  for (i = 1; i < t->ra_window; i++)
+    {
+      struct page *q = page_for_addr (addr + i * PGSIZE);
+
+      /* Only the owning process ever gives a page a frame, and
+         only with its fault_lock held, as we hold it now, so Q's
+         frame cannot appear behind our back. */
+      if (q == NULL || q->frame != NULL || !do_page_in (q, false))
+        break;
+      install_frame (q, false);
+      frame_unlock (q->frame);
+    }
+  t->ra_next = addr + i * PGSIZE;
+}
+
+/* Evicts the pages in frame F, which must be locked, leaving F
+   free.
+   Returns true if successful, false on failure. */
+bool
+page_out (struct frame *f)
+{
+  struct list_elem *e;
+  bool dirty = f->dirty;
+
+  ASSERT (lock_held_by_current_thread (&f->lock));
+  ASSERT (f->ref_cnt > 0);
+
+  /* Mark the pages not present in their page tables, forcing
+     accesses by their processes to fault.  This must happen
+     before checking the dirty bits, to prevent a race with a
+     process dirtying the frame. */
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      pagedir_clear_page (p->thread->pagedir, p->addr);
+      dirty = dirty || pagedir_is_dirty (p->thread->pagedir, p->addr);
+    }
+
+  /* A clean frame still matches the file, zero-fill, or swap
+     slot contents of every page in it, so it can simply be
+     dropped. */
+  if (!dirty)
+    {
+      frame_free (f);
+      return true;
+    }
+
+  /* Otherwise it goes back to its file or out to swap.  Pages
+     written back to files are never shared. */
+  if (!page_swappable (f))
+    {
+      write_back (list_entry (list_front (&f->pages),
+                              struct page, frame_elem));
+      frame_free (f);
+      return true;
+    }
+  return swap_out (&f, 1);
+}
+
+/* Writes the modified contents of page P, which must have a
+   locked frame, back to its file. */
+static void
+write_back (struct page *p)
+{
+  ASSERT (p->type == PAGE_FILE && p->write_back);
+  ASSERT (lock_held_by_current_thread (&p->frame->lock));
+
+  lock_acquire (&filesys_lock);
+  file_write_at (p->file, p->frame->base, p->file_bytes, p->file_offset);
+  lock_release (&filesys_lock);
+}
+
+/* Evicts the pages in the CNT dirty, swappable frames in FRAMES,
+   which must be locked and consecutive in memory, writing them
+   to consecutive swap slots in one go.
+   Returns true if successful, false on failure. */
+bool
+page_out_run (struct frame **frames, size_t cnt)
+{
+  struct list_elem *e;
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    for (e = list_begin (&frames[i]->pages); e != list_end (&frames[i]->pages);
+         e = list_next (e))
+      {
+        struct page *p = list_entry (e, struct page, frame_elem);
+        pagedir_clear_page (p->thread->pagedir, p->addr);
+      }
+  return swap_out (frames, cnt);
+}
+
+/* Returns true if any page in frame F has been accessed
+   recently, false otherwise, and clears their accessed bits.
+   F must be locked. */
+bool
+page_accessed_recently (struct frame *f)
+{
+  struct list_elem *e;
+  bool was_accessed = false;
+
+  ASSERT (lock_held_by_current_thread (&f->lock));
+
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      if (pagedir_is_accessed (p->thread->pagedir, p->addr))
+        {
+          pagedir_set_accessed (p->thread->pagedir, p->addr, false);
+          was_accessed = true;
+        }
+    }
+  return was_accessed;
+}
+
+/* Returns true if frame F has been written, through any page in
+   it, since it was last brought in.  F must be locked. */
+bool
+page_is_dirty (struct frame *f)
+{
+  struct list_elem *e;
+
+  ASSERT (lock_held_by_current_thread (&f->lock));
+
+  if (f->dirty)
+    return true;
+  for (e = list_begin (&f->pages); e != list_end (&f->pages);
+       e = list_next (e))
+    {
+      struct page *p = list_entry (e, struct page, frame_elem);
+      if (pagedir_is_dirty (p->thread->pagedir, p->addr))
+        return true;
+    }
+  return false;
+}
+
+/* Returns true if frame F, which must be locked and in use, is
+   evicted to swap when dirty, false if it is written back to a
+   file. */
+bool
+page_swappable (struct frame *f)
+{
+  ASSERT (lock_held_by_current_thread (&f->lock));
+  ASSERT (f->ref_cnt > 0);
+
+  return !list_entry (list_front (&f->pages),
+                      struct page, frame_elem)->write_back;
+}
+
+/* Tries to lock the page containing ADDR into physical memory,
+   so that the kernel can access it without faulting, for
+   example during I/O with the file system lock held.  If
+   WILL_WRITE is true, the page must be writeable; otherwise it
+   may be read-only.
+   Returns true if successful, false on failure. */
+bool
+page_lock (const void *addr, bool will_write)
+{
+  struct page_table *pt = thread_current ()->pages;
+  struct page *p;
+  bool resident;
+  bool success = false;
+
+  lock_acquire (&pt->fault_lock);
+  p = page_for_addr_or_stack (addr);
+  if (p == NULL || (!p->writable && will_write))
+    goto done;
+
+  frame_lock (p);
+  resident = p->frame != NULL;
+  if (!resident && !do_page_in (p, true))
+    goto done;
+  if (pagedir_get_page (p->thread->pagedir, p->addr) == NULL
+      && !install_frame (p, resident))
+    {
+      frame_unlock (p->frame);
+      goto done;
+    }
+
+  /* The kernel runs with write protection on, so a page that it
+     will write must get a writable mapping now: it must not
+     fault on a page whose frame it holds locked. */
+  if (will_write && !pagedir_is_writable (p->thread->pagedir, p->addr)
+      && !unshare (p))
+    {
+      frame_unlock (p->frame);
+      goto done;
+    }
+  success = true;
+
+ done:
+  lock_release (&pt->fault_lock);
+  return success;
+}
+
+/* Unlocks a page locked with page_lock(). */
+void
+page_unlock (const void *addr)
+{
+  struct page *p = page_for_addr (addr);
+  ASSERT (p != NULL);
+  frame_unlock (p->frame);
+}
+
+/* Resolves a write fault on a present but read-only mapping of
+   the page containing FAULT_ADDR.  That happens when a writable
+   page shares its frame with another process's copy of it,
+   since fork(), or did until recently.
+   Returns true if successful, false if the page really is not
+   writable or on failure. */
+bool
+page_write_fault (void *fault_addr)
+{
+  struct page_table *pt = thread_current ()->pages;
+  struct page *p;
+  bool success = false;
+
+  if (pt == NULL)
+    return false;
+  lock_acquire (&pt->fault_lock);
+  p = page_for_addr (fault_addr);
+  if (p != NULL && p->writable)
+    {
+      frame_lock (p);
+      if (p->frame == NULL)
+        {
+          /* Evicted since the fault.  Fault it back in. */
+          success = fault_in (fault_addr);
+        }
+      else
+        {
+          success = unshare (p);
+          frame_unlock (p->frame);
+        }
+    }
+  lock_release (&pt->fault_lock);
+  return success;
+}
+
+/* Gives writable page P, whose frame is locked, a frame of its
+   own, copying the frame if it is shared, and maps it writable.
+   On return P's frame, which may be a new one, is locked.
+   Returns true if successful, false on failure. */
+static bool
+unshare (struct page *p)
+{
+  uint32_t *pd = p->thread->pagedir;
+  struct frame *old = p->frame;
+  bool dirty;
+
+  ASSERT (p->writable);
+  ASSERT (lock_held_by_current_thread (&old->lock));
+
+  dirty = pagedir_is_dirty (pd, p->addr);
+  if (old->ref_cnt > 1)
+    {
+      /* Copy the frame.  The copy no longer necessarily matches
+         P's swap slot, so it counts as dirty. */
+      frame_detach (old, p);
+      if (frame_alloc_and_lock (p) == NULL)
+        {
+          frame_attach (old, p);
+          return false;
+        }
+      memcpy (p->frame->base, old->base, PGSIZE);
+      frame_unlock (old);
+      dirty = true;
+    }
+
+  pagedir_clear_page (pd, p->addr);
+  if (!pagedir_set_page (pd, p->addr, p->frame->base, true))
+    return false;
+  pagedir_set_dirty (pd, p->addr, dirty);
+  pagedir_set_accessed (pd, p->addr, true);
+  return true;
+}
+
+/* Remaps page P, whose frame is locked, read-only in its owner's
+   page directory, if it is mapped at all, keeping its accessed
+   and dirty bits.
+   Returns true if successful, false on failure. */
+static bool
+map_read_only (struct page *p)
+{
+  uint32_t *pd = p->thread->pagedir;
+  bool accessed, dirty;
+
+  if (pagedir_get_page (pd, p->addr) == NULL)
+    return true;
+
+  accessed = pagedir_is_accessed (pd, p->addr);
+  dirty = pagedir_is_dirty (pd, p->addr);
+  pagedir_clear_page (pd, p->addr);
+  if (!pagedir_set_page (pd, p->addr, p->frame->base, false))
+    return false;
+  pagedir_set_accessed (pd, p->addr, accessed);
+  pagedir_set_dirty (pd, p->addr, dirty);
+  return true;
+}
+
+/* Fills the current thread's empty page table with copies of
+   the pages of PARENT's process, where PARENT must be blocked
+   for the duration; its page table's fault_lock keeps the
+   process's other threads from changing it meanwhile.  Resident
+   pages share the parent's frames copy-on-write, and
+   the parent's writable mappings of them become read-only.  The
+   current thread's page directory is left empty, to be filled
+   in by faults as the child touches its pages.  Memory-mapped
+   files are not inherited.
+   Returns true if successful, false on failure. */
+bool
+page_table_copy (struct thread *parent)
+{
+  struct thread *cur = thread_current ();
+  struct page_table *ppt = parent->pages;
+  struct hash_iterator i;
+  bool success = true;
+
+  lock_acquire (&ppt->fault_lock);
+  hash_first (&i, &ppt->pages);
+  while (success && hash_next (&i))
+    {
+      struct page *pp = hash_entry (hash_cur (&i), struct page, hash_elem);
+      struct page *c;
+      bool ok = true;
+
+      if (pp->write_back)
+        continue;
+
+      c = page_alloc (pp->addr, pp->writable);
+      if (c == NULL)
+        {
+          success = false;
+          break;
+        }
+      c->type = pp->type;
+      c->file = (pp->file == parent->leader->bin_file
+                 ? cur->bin_file : pp->file);
+      c->file_offset = pp->file_offset;
+      c->file_bytes = pp->file_bytes;
+
+      frame_lock (pp);
+      if (pp->sector != (block_sector_t) -1)
+        {
+          if (swap_dup (pp->sector))
+            c->sector = pp->sector;
+          else
+            ok = false;
+        }
+      if (ok && pp->frame != NULL)
+        {
+          /* The frame may differ from what the child's page
+             would be read back from.  Record that in the frame
+             itself, since the parent may stop sharing it, and
+             the child has no page table entry yet. */
+          if (pagedir_is_dirty (parent->pagedir, pp->addr))
+            pp->frame->dirty = true;
+          frame_attach (pp->frame, c);
+          if (pp->writable)
+            ok = map_read_only (pp);
+        }
+      if (pp->frame != NULL)
+        frame_unlock (pp->frame);
+      success = ok;
+    }
+  lock_release (&ppt->fault_lock);
+  return success;
+}
+
+/* Returns true if P is a read-only page of a file, such as a
+   page of an executable's code, whose frame can be shared with
+   any other process mapping the same part of the same file. */
+static bool
+is_text (const struct page *p)
+{
+  return p->type == PAGE_FILE && !p->writable && !p->write_back;
+}
+
+/* Returns a hash value for the page that E refers to. */
+unsigned
+page_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct page *p = hash_entry (e, struct page, hash_elem);
+  return ((uintptr_t) p->addr) >> PGBITS;
+}
+
+/* Returns true if page A precedes page B. */
+bool
+page_less (const struct hash_elem *a_, const struct hash_elem *b_,
+           void *aux UNUSED)
+{
+  const struct page *a = hash_entry (a_, struct page, hash_elem);
+  const struct page *b = hash_entry (b_, struct page, hash_elem);
+
+  return a->addr < b->addr;
+}
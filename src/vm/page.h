@@ -0,0 +1,100 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <hash.h>
+#include <stdbool.h>
+#include "devices/block.h"
+#include "filesys/off_t.h"
+#include "threads/synch.h"
+
+/* Where a page's contents come from when it is not in a frame. */
+enum page_type
+  {
+    PAGE_ZERO,                  /* All zeros. */
+    PAGE_FILE,                  /* Read from a file, zero-padded. */
+    PAGE_SWAP                   /* Saved in a swap slot. */
+  };
+
+/* A user process's supplemental page table, shared by all of
+   its threads.
+
+   FAULT_LOCK serializes everything that gives pages frames or
+   adds and removes pages: faults, page_lock(), page_alloc(),
+   page_deallocate(), and copying the table for fork().  It is
+   acquired before any frame lock and never while holding one.
+   LOCK, a leaf lock, protects the hash table itself, so that
+   page_unlock() can look up a page without FAULT_LOCK. */
+struct page_table
+  {
+    struct hash pages;          /* Pages, keyed by address. */
+    struct lock lock;           /* Protects PAGES. */
+    struct lock fault_lock;     /* Serializes faults. */
+  };
+
+/* A virtual page of a user process's address space.
+   Entries live in the process's page table, keyed by ADDR. */
+struct page
+  {
+    /* Immutable members. */
+    void *addr;                 /* User virtual address. */
+    bool writable;              /* False for read-only pages. */
+    struct thread *thread;      /* Owning process's first thread. */
+
+    /* Accessed only in owning process context. */
+    struct hash_elem hash_elem; /* struct page_table `pages' element. */
+
+    /* Set only in owning process context with frame->lock held,
+       or by fork() with the owner's fault_lock held.  Cleared
+       only with frame->lock held, possibly by another process
+       evicting the page. */
+    struct frame *frame;        /* Page frame, or NULL if not resident. */
+    struct list_elem frame_elem; /* struct frame `pages' list element. */
+
+    /* Where the contents are when FRAME is null. */
+    enum page_type type;
+
+    /* First sector of the page's swap slot, or (block_sector_t) -1
+       if it has none.  A PAGE_SWAP page keeps its slot while it
+       is resident, so that it can be dropped if it stays clean. */
+    block_sector_t sector;
+
+    /* PAGE_FILE: FILE_BYTES bytes at FILE_OFFSET in FILE, the
+       rest of the page zeroed.  If WRITE_BACK is true, as for
+       memory-mapped files, changes are written back to the file
+       instead of to swap. */
+    struct file *file;          /* File. */
+    off_t file_offset;          /* Offset in file. */
+    off_t file_bytes;           /* Bytes to read, 1...PGSIZE. */
+    bool write_back;            /* True to write back to FILE. */
+  };
+
+/* Most pages the user stack may grow to.
+   Controlled by kernel command-line option "-stack". */
+extern size_t stack_max_pages;
+
+bool page_table_create (void);
+void page_table_destroy (void);
+
+struct page *page_alloc (void *vaddr, bool writable);
+void page_deallocate (void *vaddr);
+void page_deallocate_range (void *vaddr, size_t page_cnt);
+
+bool page_in (void *fault_addr);
+bool page_write_fault (void *fault_addr);
+bool page_table_copy (struct thread *parent);
+
+/* Eviction, on behalf of vm/frame.c. */
+struct frame;
+bool page_out (struct frame *);
+bool page_out_run (struct frame **, size_t cnt);
+bool page_accessed_recently (struct frame *);
+bool page_is_dirty (struct frame *);
+bool page_swappable (struct frame *);
+
+bool page_lock (const void *, bool will_write);
+void page_unlock (const void *);
+
+hash_hash_func page_hash;
+hash_less_func page_less;
+
+#endif /* vm/page.h */
@@ -0,0 +1,306 @@
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <console.h>
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include "vm/frame.h"
+#include "vm/page.h"
+#include "vm/zswap.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+
+/* The swap device. */
+static struct block *swap_device;
+
+/* Used swap slots.  Slot N is sectors N * PAGE_SECTORS through
+   N * PAGE_SECTORS + PAGE_SECTORS - 1 of the swap device. */
+static struct bitmap *swap_bitmap;
+
+/* Slot at which to start looking for free slots.  Allocating
+   upward from where the last search ended keeps pages that are
+   evicted one after another next to each other on disk. */
+static size_t next_slot;
+
+/* A swap slot held by more than one page, which happens when
+   fork() copies a page that has a slot.  Slots held by a single
+   page, by far the common case, have no entry. */
+struct shared_slot
+  {
+    struct hash_elem elem;      /* `shared_slots' hash element. */
+    size_t slot;                /* Slot number. */
+    int ref_cnt;                /* Number of pages holding it, >= 2. */
+  };
+
+/* Shared slots, keyed by slot number. */
+static struct hash shared_slots;
+
+/* Protects swap_bitmap, next_slot, and shared_slots. */
+static struct lock swap_lock;
+
+static size_t alloc_slots (size_t cnt);
+static bool share_slots (struct frame **frames, size_t cnt, size_t slot);
+static struct shared_slot *find_shared (size_t slot);
+static void release_slot (size_t slot);
+static hash_hash_func shared_slot_hash;
+static hash_less_func shared_slot_less;
+
+/* Sets up swap. */
+void
+swap_init (void)
+{
+  lock_init (&swap_lock);
+  hash_init (&shared_slots, shared_slot_hash, shared_slot_less, NULL);
+  swap_device = block_get_role (BLOCK_SWAP);
+  if (swap_device == NULL)
+    {
+      klog (KLOG_WARN, "no swap device--swap disabled");
+      swap_bitmap = bitmap_create (0);
+    }
+  else
+    swap_bitmap = bitmap_create (block_size (swap_device) / PAGE_SECTORS);
+  if (swap_bitmap == NULL)
+    PANIC ("couldn't create swap bitmap");
+  zswap_init (swap_device);
+}
+
+/* Allocates CNT consecutive free swap slots and returns the
+   first, or BITMAP_ERROR if there is no such run.
+   The caller must hold swap_lock. */
+static size_t
+alloc_slots (size_t cnt)
+{
+  size_t slot = bitmap_scan_and_flip (swap_bitmap, next_slot, cnt, false);
+  if (slot == BITMAP_ERROR && next_slot != 0)
+    slot = bitmap_scan_and_flip (swap_bitmap, 0, cnt, false);
+  if (slot != BITMAP_ERROR)
+    next_slot = slot + cnt;
+  return slot;
+}
+
+/* Creates a shared_slots entry for each of the CNT slots
+   starting at SLOT, which must be newly allocated, that will be
+   held by more than one page, that is, whose frame in FRAMES
+   holds more than one page.  Returns true if successful.  On
+   memory allocation failure, removes the entries it created and
+   returns false.
+   The caller must hold swap_lock. */
+static bool
+share_slots (struct frame **frames, size_t cnt, size_t slot)
+{
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    {
+      size_t page_cnt = list_size (&frames[i]->pages);
+      if (page_cnt > 1)
+        {
+          struct shared_slot *s = malloc (sizeof *s);
+          if (s == NULL)
+            {
+              while (i-- > 0)
+                {
+                  s = find_shared (slot + i);
+                  if (s != NULL)
+                    {
+                      hash_delete (&shared_slots, &s->elem);
+                      free (s);
+                    }
+                }
+              return false;
+            }
+          s->slot = slot + i;
+          s->ref_cnt = page_cnt;
+          hash_insert (&shared_slots, &s->elem);
+        }
+    }
+  return true;
+}
+
+/* Swaps out the pages in the CNT frames in FRAMES, which must
+   be locked, consecutive in memory, and in use, in the order
+   given.  Their pages must already be unmapped from their page
+   directories.  The frames go into consecutive slots, shared by
+   all of the pages in each frame, and the frames become free.
+   Frames that compress well go into compressed swap, and each
+   run of the others goes to the swap device in a single
+   multi-sector write.  Any slot that a page held
+   before is released.
+   Returns true if successful, false if no run of CNT free slots
+   was available or on memory allocation failure, in which case
+   nothing changes. */
+bool
+swap_out (struct frame **frames, size_t cnt)
+{
+  size_t slot;
+  size_t i;
+
+  ASSERT (cnt > 0);
+  for (i = 0; i < cnt; i++)
+    {
+      ASSERT (lock_held_by_current_thread (&frames[i]->lock));
+      ASSERT (frames[i]->ref_cnt > 0);
+      ASSERT (frames[i]->base == (uint8_t *) frames[0]->base + i * PGSIZE);
+    }
+
+  /* Take the slots, and record which of them are shared, before
+     writing anything, so that failure leaves nothing to undo but
+     the allocation. */
+  lock_acquire (&swap_lock);
+  slot = alloc_slots (cnt);
+  if (slot != BITMAP_ERROR && !share_slots (frames, cnt, slot))
+    {
+      bitmap_set_multiple (swap_bitmap, slot, cnt, false);
+      slot = BITMAP_ERROR;
+    }
+  lock_release (&swap_lock);
+  if (slot == BITMAP_ERROR)
+    return false;
+
+  i = 0;
+  while (i < cnt)
+    {
+      size_t run = 0;
+      while (i + run < cnt && !zswap_store (slot + i + run,
+                                            frames[i + run]->base))
+        run++;
+      if (run > 0)
+        block_write_multiple (swap_device, (slot + i) * PAGE_SECTORS,
+                              run * PAGE_SECTORS, frames[i]->base);
+
+      /* Skip the frame that went into compressed swap, if any. */
+      i += run + 1;
+    }
+
+  for (i = 0; i < cnt; i++)
+    {
+      block_sector_t sector = (slot + i) * PAGE_SECTORS;
+      struct list_elem *e;
+
+      for (e = list_begin (&frames[i]->pages);
+           e != list_end (&frames[i]->pages); e = list_next (e))
+        {
+          struct page *p = list_entry (e, struct page, frame_elem);
+          swap_free (p);
+          p->type = PAGE_SWAP;
+          p->sector = sector;
+        }
+      frame_free (frames[i]);
+    }
+  return true;
+}
+
+/* Swaps in page P, which must have a locked frame (and be
+   swapped out).  P keeps its slot, so that as long as P is not
+   modified it can be evicted again without writing it. */
+void
+swap_in (struct page *p)
+{
+  ASSERT (p->frame != NULL);
+  ASSERT (lock_held_by_current_thread (&p->frame->lock));
+  ASSERT (p->type == PAGE_SWAP);
+  ASSERT (p->sector != (block_sector_t) -1);
+
+  if (!zswap_load (p->sector / PAGE_SECTORS, p->frame->base))
+    block_read_multiple (swap_device, p->sector, PAGE_SECTORS,
+                         p->frame->base);
+}
+
+/* Adds a page to the holders of the swap slot that begins at
+   SECTOR, which must be in use.  Each holder releases it with
+   swap_free().
+   Returns true if successful, false on memory allocation
+   failure. */
+bool
+swap_dup (block_sector_t sector)
+{
+  size_t slot = sector / PAGE_SECTORS;
+  struct shared_slot *s;
+  bool success = true;
+
+  lock_acquire (&swap_lock);
+  ASSERT (bitmap_test (swap_bitmap, slot));
+  s = find_shared (slot);
+  if (s != NULL)
+    s->ref_cnt++;
+  else
+    {
+      s = malloc (sizeof *s);
+      if (s != NULL)
+        {
+          s->slot = slot;
+          s->ref_cnt = 2;
+          hash_insert (&shared_slots, &s->elem);
+        }
+      else
+        success = false;
+    }
+  lock_release (&swap_lock);
+  return success;
+}
+
+/* Releases P's swap slot, if it has one.  The slot becomes free
+   once no other page holds it. */
+void
+swap_free (struct page *p)
+{
+  if (p->sector != (block_sector_t) -1)
+    {
+      lock_acquire (&swap_lock);
+      release_slot (p->sector / PAGE_SECTORS);
+      lock_release (&swap_lock);
+      p->sector = (block_sector_t) -1;
+    }
+}
+
+/* Drops one holder of SLOT, freeing it if that was the last.
+   The caller must hold swap_lock. */
+static void
+release_slot (size_t slot)
+{
+  struct shared_slot *s = find_shared (slot);
+  if (s == NULL)
+    {
+      /* Forget any compressed copy before the slot can be
+         reused. */
+      zswap_drop (slot);
+      bitmap_reset (swap_bitmap, slot);
+    }
+  else if (--s->ref_cnt == 1)
+    {
+      hash_delete (&shared_slots, &s->elem);
+      free (s);
+    }
+}
+
+/* Returns the shared_slots entry for SLOT, or a null pointer if
+   SLOT is not shared.  The caller must hold swap_lock. */
+static struct shared_slot *
+find_shared (size_t slot)
+{
+  struct shared_slot key;
+  struct hash_elem *e;
+
+  key.slot = slot;
+  e = hash_find (&shared_slots, &key.elem);
+  return e != NULL ? hash_entry (e, struct shared_slot, elem) : NULL;
+}
+
+/* Returns a hash value for the shared slot that E refers to. */
+static unsigned
+shared_slot_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct shared_slot *s = hash_entry (e, struct shared_slot, elem);
+  return hash_int (s->slot);
+}
+
+/* Returns true if shared slot A precedes shared slot B. */
+static bool
+shared_slot_less (const struct hash_elem *a_, const struct hash_elem *b_,
+                  void *aux UNUSED)
+{
+  const struct shared_slot *a = hash_entry (a_, struct shared_slot, elem);
+  const struct shared_slot *b = hash_entry (b_, struct shared_slot, elem);
+
+  return a->slot < b->slot;
+}
@@ -0,0 +1,21 @@
+#ifndef VM_SWAP_H
+#define VM_SWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "devices/block.h"
+#include "threads/vaddr.h"
+
+struct frame;
+struct page;
+
+/* Number of sectors per page, and so per swap slot. */
+#define PAGE_SECTORS (PGSIZE / BLOCK_SECTOR_SIZE)
+
+void swap_init (void);
+bool swap_out (struct frame **, size_t cnt);
+void swap_in (struct page *);
+bool swap_dup (block_sector_t sector);
+void swap_free (struct page *);
+
+#endif /* vm/swap.h */
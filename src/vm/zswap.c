@@ -0,0 +1,287 @@
+#include "vm/zswap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <lz.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "vm/swap.h"
+#include "devices/block.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Compressed swap.
+
+   Pages on their way out to a swap slot are compressed and kept
+   in a pool of kernel memory instead, in front of the swap
+   device, so that swapping them back in is a decompression
+   rather than a disk read.  When the pool fills up, the least
+   recently used pages in it are written out to their slots on
+   the swap device to make room.  Pages that do not compress to
+   at most MAX_ZSIZE bytes go straight to the swap device.
+
+   The pool is carved up into CHUNK_SIZE-byte chunks, and each
+   page takes a run of consecutive chunks. */
+
+/* Pool allocation unit, in bytes. */
+#define CHUNK_SIZE 64
+
+/* Largest compressed page worth keeping. */
+#define MAX_ZSIZE (PGSIZE / 2)
+
+/* Pages of memory for compressed swap: 512 kB by default, or
+   none to disable it.
+   Controlled by kernel command-line option "-zswap". */
+size_t zswap_pages = 128;
+
+/* A compressed page. */
+struct zpage
+  {
+    struct hash_elem hash_elem; /* `zpages' hash element. */
+    struct list_elem lru_elem;  /* `lru' list element. */
+    size_t slot;                /* Swap slot that it stands for. */
+    size_t chunk;               /* First chunk in pool. */
+    size_t size;                /* Compressed size in bytes. */
+  };
+
+static struct block *swap_device;
+
+static uint8_t *pool;           /* Compressed pages. */
+static struct bitmap *used;     /* Chunks in use in POOL. */
+static struct hash zpages;      /* Pages in POOL, by slot. */
+static struct list lru;         /* Pages in POOL, least recent first. */
+
+/* Scratch pages: compressor output, a page being written out,
+   and compressor work area. */
+static uint8_t *zbuf, *bounce, *work;
+
+/* Protects everything above, and the statistics. */
+static struct lock zswap_lock;
+
+/* Statistics. */
+static long long store_cnt;     /* Pages compressed into the pool. */
+static long long reject_cnt;    /* Pages that did not compress. */
+static long long hit_cnt;       /* Swap-ins from the pool. */
+static long long miss_cnt;      /* Swap-ins from the swap device. */
+static long long spill_cnt;     /* Pages written out to make room. */
+static long long zbytes;        /* Total compressed size stored. */
+
+static struct zpage *find_zpage (size_t slot);
+static void remove_zpage (struct zpage *);
+static void spill (struct zpage *);
+static hash_hash_func zpage_hash;
+static hash_less_func zpage_less;
+
+/* Sets up compressed swap in front of SWAP_DEVICE. */
+void
+zswap_init (struct block *swap_device_)
+{
+  size_t chunk_cnt;
+
+  swap_device = swap_device_;
+  lock_init (&zswap_lock);
+  hash_init (&zpages, zpage_hash, zpage_less, NULL);
+  list_init (&lru);
+  if (swap_device == NULL || zswap_pages == 0)
+    return;
+
+  pool = palloc_get_multiple (0, zswap_pages);
+  zbuf = palloc_get_page (0);
+  bounce = palloc_get_page (0);
+  work = palloc_get_page (0);
+  chunk_cnt = zswap_pages * (PGSIZE / CHUNK_SIZE);
+  used = pool != NULL ? bitmap_create (chunk_cnt) : NULL;
+  if (used == NULL || zbuf == NULL || bounce == NULL || work == NULL)
+    {
+      printf ("zswap: not enough memory--compressed swap disabled\n");
+      if (pool != NULL)
+        palloc_free_multiple (pool, zswap_pages);
+      palloc_free_page (zbuf);
+      palloc_free_page (bounce);
+      palloc_free_page (work);
+      pool = NULL;
+      return;
+    }
+  ASSERT (LZ_WORK_SIZE <= PGSIZE);
+  printf ("zswap: %zu kB pool\n", zswap_pages * PGSIZE / 1024);
+}
+
+/* Compresses the page at PAGE into the pool, to stand for the
+   contents of swap SLOT, which must be in use and not already be
+   in the pool.  If that takes room that is in use, first writes
+   the least recently used pages in the pool out to their slots.
+   Returns true if successful, false if PAGE does not compress
+   well, or compressed swap is disabled, in which case the caller
+   must write PAGE to SLOT itself. */
+bool
+zswap_store (size_t slot, const void *page)
+{
+  struct zpage *z;
+  size_t size;
+  size_t chunk;
+
+  if (pool == NULL)
+    return false;
+
+  z = malloc (sizeof *z);
+  if (z == NULL)
+    return false;
+
+  lock_acquire (&zswap_lock);
+  ASSERT (find_zpage (slot) == NULL);
+  size = lz_compress (page, PGSIZE, zbuf, MAX_ZSIZE, work);
+  if (size == 0)
+    {
+      reject_cnt++;
+      lock_release (&zswap_lock);
+      free (z);
+      return false;
+    }
+
+  /* Make room. */
+  while ((chunk = bitmap_scan_and_flip (used, 0,
+                                        DIV_ROUND_UP (size, CHUNK_SIZE),
+                                        false)) == BITMAP_ERROR)
+    {
+      ASSERT (!list_empty (&lru));
+      spill (list_entry (list_front (&lru), struct zpage, lru_elem));
+    }
+
+  memcpy (pool + chunk * CHUNK_SIZE, zbuf, size);
+  z->slot = slot;
+  z->chunk = chunk;
+  z->size = size;
+  hash_insert (&zpages, &z->hash_elem);
+  list_push_back (&lru, &z->lru_elem);
+  store_cnt++;
+  zbytes += size;
+  lock_release (&zswap_lock);
+  return true;
+}
+
+/* If swap SLOT is in the pool, decompresses it into PAGE and
+   returns true.  Otherwise, returns false, and the caller must
+   read SLOT from the swap device.  The pool keeps its copy for
+   as long as SLOT is in use, so that a page that stays clean can
+   be dropped again. */
+bool
+zswap_load (size_t slot, void *page)
+{
+  struct zpage *z;
+  size_t size UNUSED;
+
+  if (pool == NULL)
+    return false;
+
+  lock_acquire (&zswap_lock);
+  z = find_zpage (slot);
+  if (z != NULL)
+    {
+      size = lz_decompress (pool + z->chunk * CHUNK_SIZE, z->size,
+                            page, PGSIZE);
+      ASSERT (size == PGSIZE);
+      list_remove (&z->lru_elem);
+      list_push_back (&lru, &z->lru_elem);
+      hit_cnt++;
+    }
+  else
+    miss_cnt++;
+  lock_release (&zswap_lock);
+  return z != NULL;
+}
+
+/* Forgets swap SLOT, which is being freed, if it is in the
+   pool. */
+void
+zswap_drop (size_t slot)
+{
+  struct zpage *z;
+
+  if (pool == NULL)
+    return;
+
+  lock_acquire (&zswap_lock);
+  z = find_zpage (slot);
+  if (z != NULL)
+    remove_zpage (z);
+  lock_release (&zswap_lock);
+}
+
+/* Prints compressed swap statistics. */
+void
+zswap_print_stats (void)
+{
+  if (pool == NULL)
+    return;
+  printf ("Zswap: %lld pages stored at %lld%% of their size, "
+          "%lld did not compress\n",
+          store_cnt, store_cnt > 0 ? zbytes * 100 / (store_cnt * PGSIZE) : 0,
+          reject_cnt);
+  printf ("Zswap: %lld hits, %lld misses, %lld pages spilled to disk\n",
+          hit_cnt, miss_cnt, spill_cnt);
+}
+
+/* Returns the page in the pool for SLOT, or a null pointer if
+   there is none.  The caller must hold zswap_lock. */
+static struct zpage *
+find_zpage (size_t slot)
+{
+  struct zpage key;
+  struct hash_elem *e;
+
+  key.slot = slot;
+  e = hash_find (&zpages, &key.hash_elem);
+  return e != NULL ? hash_entry (e, struct zpage, hash_elem) : NULL;
+}
+
+/* Removes Z from the pool and frees it.  The caller must hold
+   zswap_lock. */
+static void
+remove_zpage (struct zpage *z)
+{
+  hash_delete (&zpages, &z->hash_elem);
+  list_remove (&z->lru_elem);
+  bitmap_set_multiple (used, z->chunk, DIV_ROUND_UP (z->size, CHUNK_SIZE),
+                       false);
+  free (z);
+}
+
+/* Writes Z out to its slot on the swap device and removes it
+   from the pool.  The caller must hold zswap_lock. */
+static void
+spill (struct zpage *z)
+{
+  size_t size UNUSED;
+
+  size = lz_decompress (pool + z->chunk * CHUNK_SIZE, z->size,
+                        bounce, PGSIZE);
+  ASSERT (size == PGSIZE);
+  block_write_multiple (swap_device, z->slot * PAGE_SECTORS, PAGE_SECTORS,
+                        bounce);
+  spill_cnt++;
+  remove_zpage (z);
+}
+
+/* Returns a hash value for the compressed page that E refers
+   to. */
+static unsigned
+zpage_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct zpage *z = hash_entry (e, struct zpage, hash_elem);
+  return hash_int (z->slot);
+}
+
+/* Returns true if compressed page A precedes page B. */
+static bool
+zpage_less (const struct hash_elem *a_, const struct hash_elem *b_,
+            void *aux UNUSED)
+{
+  const struct zpage *a = hash_entry (a_, struct zpage, hash_elem);
+  const struct zpage *b = hash_entry (b_, struct zpage, hash_elem);
+
+  return a->slot < b->slot;
+}
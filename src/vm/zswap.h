@@ -0,0 +1,19 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct block;
+
+/* Pages of memory for compressed swap.
+   Controlled by kernel command-line option "-zswap". */
+extern size_t zswap_pages;
+
+void zswap_init (struct block *swap_device);
+bool zswap_store (size_t slot, const void *page);
+bool zswap_load (size_t slot, void *page);
+void zswap_drop (size_t slot);
+void zswap_print_stats (void);
+
+#endif /* vm/zswap.h */